@@ -7,6 +7,234 @@ namespace goldfish { namespace stream
 {
 	struct ill_formatted_base64_data : ill_formatted { using ill_formatted::ill_formatted; };
 
+	namespace details
+	{
+		// Returns the 6 bits value of a base64 character, or a value >= 64 if the character is invalid
+		inline byte base64_character_to_6bits(byte c)
+		{
+			static const byte lookup_table[] = {
+				64,64,64,64,64,64,64,64,64,64,
+				64,64,64,64,64,64,64,64,64,64,
+				64,64,64,64,64,64,64,64,64,64,
+				64,64,64,64,64,64,64,64,64,64,
+				64,64,64,62,64,64,64,63,52,53,
+				54,55,56,57,58,59,60,61,64,64,
+				64,65,64,64,64, 0, 1, 2, 3, 4,
+				 5, 6, 7, 8, 9,10,11,12,13,14,
+				15,16,17,18,19,20,21,22,23,24,
+				25,64,64,64,64,64,64,26,27,28,
+				29,30,31,32,33,34,35,36,37,38,
+				39,40,41,42,43,44,45,46,47,48,
+				49,50,51,64,64,64,64,64,64,64,
+				64,64,64,64,64,64,64,64,64,64,
+				64,64,64,64,64,64,64,64,64,64,
+				64,64,64,64,64,64,64,64,64,64,
+				64,64,64,64,64,64,64,64,64,64,
+				64,64,64,64,64,64,64,64,64,64,
+				64,64,64,64,64,64,64,64,64,64,
+				64,64,64,64,64,64,64,64,64,64,
+				64,64,64,64,64,64,64,64,64,64,
+				64,64,64,64,64,64,64,64,64,64,
+				64,64,64,64,64,64,64,64,64,64,
+				64,64,64,64,64,64,64,64,64,64,
+				64,64,64,64,64,64,64,64,64,64,
+				64,64,64,64,64,64
+			};
+			static_assert(sizeof(lookup_table) == 256, "");
+			return lookup_table[c];
+		}
+
+		#if defined(GOLDFISH_AVX2) || defined(GOLDFISH_SSE4_1)
+		/* Vectorized base64 decoding, see "Faster Base64 Encoding and Decoding using AVX2 Instructions" (W. Mula, D. Lemire)
+		Each character is classified using its high and low nibbles (which detects invalid characters), then translated
+		to its 6 bits value by adding an offset that only depends on the high nibble (except for '/')
+		The 6 bits values are then packed 4 by 4 into 3 bytes */
+		inline __m128i decode_base64_16_characters(__m128i input, bool& valid)
+		{
+			const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+			const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+			const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+			const __m128i mask_2F = _mm_set1_epi8(0x2F);
+
+			auto hi_nibbles = _mm_and_si128(_mm_srli_epi32(input, 4), mask_2F);
+			auto lo_nibbles = _mm_and_si128(input, mask_2F);
+			auto hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+			auto lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+			valid = _mm_testz_si128(lo, hi) != 0;
+
+			auto roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(_mm_cmpeq_epi8(input, mask_2F), hi_nibbles));
+			auto values = _mm_add_epi8(input, roll);
+
+			auto merged = _mm_madd_epi16(_mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140)), _mm_set1_epi32(0x00011000));
+			return _mm_shuffle_epi8(merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+		}
+		#endif
+		#ifdef GOLDFISH_AVX2
+		inline __m256i decode_base64_32_characters(__m256i input, bool& valid)
+		{
+			const __m256i lut_lo = _mm256_setr_epi8(
+				0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+				0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+			const __m256i lut_hi = _mm256_setr_epi8(
+				0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+				0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+			const __m256i lut_roll = _mm256_setr_epi8(
+				0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+				0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+			const __m256i mask_2F = _mm256_set1_epi8(0x2F);
+
+			auto hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(input, 4), mask_2F);
+			auto lo_nibbles = _mm256_and_si256(input, mask_2F);
+			auto hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+			auto lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+			valid = _mm256_testz_si256(lo, hi) != 0;
+
+			auto roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(_mm256_cmpeq_epi8(input, mask_2F), hi_nibbles));
+			auto values = _mm256_add_epi8(input, roll);
+
+			auto merged = _mm256_madd_epi16(_mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140)), _mm256_set1_epi32(0x00011000));
+			merged = _mm256_shuffle_epi8(merged, _mm256_setr_epi8(
+				2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+				2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+			return _mm256_permutevar8x32_epi32(merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+		}
+		#endif
+
+		#if defined(GOLDFISH_AVX2) || defined(GOLDFISH_SSE4_1)
+		/* Vectorized base64 encoding, see "Faster Base64 Encoding and Decoding using AVX2 Instructions" (W. Mula, D. Lemire)
+		Each group of 3 bytes is spread over 4 bytes holding 6 bits each, which are then translated to characters
+		by adding an offset that only depends on the range of the 6 bits value */
+		inline __m128i encode_base64_12_bytes(__m128i input)
+		{
+			input = _mm_shuffle_epi8(input, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+			auto indices = _mm_or_si128(
+				_mm_mulhi_epu16(_mm_and_si128(input, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040)),
+				_mm_mullo_epi16(_mm_and_si128(input, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010)));
+
+			const __m128i lut_offset = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+			auto range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+			range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+			return _mm_add_epi8(indices, _mm_shuffle_epi8(lut_offset, range));
+		}
+		#endif
+		#ifdef GOLDFISH_AVX2
+		inline __m256i encode_base64_24_bytes(__m256i input)
+		{
+			input = _mm256_shuffle_epi8(input, _mm256_setr_epi8(
+				1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+				1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+			auto indices = _mm256_or_si256(
+				_mm256_mulhi_epu16(_mm256_and_si256(input, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040)),
+				_mm256_mullo_epi16(_mm256_and_si256(input, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010)));
+
+			const __m256i lut_offset = _mm256_setr_epi8(
+				'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+				'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+			auto range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+			range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+			return _mm256_add_epi8(indices, _mm256_shuffle_epi8(lut_offset, range));
+		}
+		#endif
+
+		inline byte base64_character_from_6bits(uint32_t x)
+		{
+			static const char table[65] =
+				"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+				"abcdefghijklmnopqrstuvwxyz"
+				"0123456789+/";
+			return static_cast<byte>(table[x & 63]);
+		}
+
+		// Encodes cb bytes (a multiple of 3) into cb / 3 * 4 base64 characters
+		inline void encode_base64_blocks(const byte* input, size_t cb, byte* output)
+		{
+			assert(cb % 3 == 0);
+
+			// The vectorized loops read a few bytes past the encoded data, so they stop while there is enough input left
+			#ifdef GOLDFISH_AVX2
+			while (cb >= 12 + 16)
+			{
+				auto lanes = _mm256_inserti128_si256(
+					_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input))),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 12)), 1);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(output), encode_base64_24_bytes(lanes));
+				input += 24;
+				output += 32;
+				cb -= 24;
+			}
+			#endif
+			#if defined(GOLDFISH_AVX2) || defined(GOLDFISH_SSE4_1)
+			while (cb >= 16)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(output), encode_base64_12_bytes(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input))));
+				input += 12;
+				output += 16;
+				cb -= 12;
+			}
+			#endif
+
+			for (; cb > 0; cb -= 3, input += 3, output += 4)
+			{
+				uint32_t x = (static_cast<uint32_t>(input[0]) << 16) | (static_cast<uint32_t>(input[1]) << 8) | input[2];
+				output[0] = base64_character_from_6bits(x >> 18);
+				output[1] = base64_character_from_6bits(x >> 12);
+				output[2] = base64_character_from_6bits(x >> 6);
+				output[3] = base64_character_from_6bits(x);
+			}
+		}
+
+		// Decodes c_characters base64 characters (a multiple of 4, without padding) into c_characters / 4 * 3 bytes
+		// Returns false if one of the characters is not a valid base64 character
+		inline bool decode_base64_blocks(const byte* input, size_t c_characters, byte* output)
+		{
+			assert(c_characters % 4 == 0);
+
+			// The vectorized loops write a few bytes past the decoded data, so they stop while there is enough room left in the output
+			#ifdef GOLDFISH_AVX2
+			while (c_characters >= 32 + 12)
+			{
+				bool valid;
+				auto decoded = decode_base64_32_characters(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input)), valid);
+				if (!valid)
+					return false;
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(output), decoded);
+				input += 32;
+				output += 24;
+				c_characters -= 32;
+			}
+			#endif
+			#if defined(GOLDFISH_AVX2) || defined(GOLDFISH_SSE4_1)
+			while (c_characters >= 16 + 8)
+			{
+				bool valid;
+				auto decoded = decode_base64_16_characters(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input)), valid);
+				if (!valid)
+					return false;
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(output), decoded);
+				input += 16;
+				output += 12;
+				c_characters -= 16;
+			}
+			#endif
+
+			for (; c_characters > 0; c_characters -= 4, input += 4, output += 3)
+			{
+				uint32_t a = base64_character_to_6bits(input[0]);
+				uint32_t b = base64_character_to_6bits(input[1]);
+				uint32_t c = base64_character_to_6bits(input[2]);
+				uint32_t d = base64_character_to_6bits(input[3]);
+				if ((a | b | c | d) >= 64)
+					return false;
+
+				uint32_t x = (a << 18) | (b << 12) | (c << 6) | d;
+				output[0] = static_cast<byte>(x >> 16);
+				output[1] = static_cast<byte>(x >> 8);
+				output[2] = static_cast<byte>(x);
+			}
+			return true;
+		}
+	}
+
 	// Reads binary data assuming inner reads base64
 	template <class inner> class base64_reader
 	{
@@ -21,9 +249,7 @@ namespace goldfish { namespace stream
 			read_from_already_parsed(data);
 			while (data.size() >= 3)
 			{
-				auto c_read = deserialize_up_to_3_bytes(data);
-				data.remove_front(c_read);
-				if (c_read != 3)
+				if (!deserialize_blocks(data))
 					return original_size - data.size();
 			}
 
@@ -44,12 +270,59 @@ namespace goldfish { namespace stream
 			std::copy(m_already_parsed.begin() + cb_to_copy, m_already_parsed.end(), m_already_parsed.begin());
 		}
 
-		// Read up to 4 characters (or the end of stream), remove the potential padding (base64 can be padded with '=' characters at the end)
-		// and generate up to 3 bytes of data
+		// Read as many blocks of 4 characters as fit in data and decode them in bulk
+		// Returns false if the end of the stream was reached
+		bool deserialize_blocks(buffer_ref& data)
+		{
+			byte characters[typical_buffer_length];
+			auto c_requested = std::min<size_t>(data.size() / 3 * 4, sizeof(characters));
+			auto c_read = read_full_buffer(m_stream, { characters, c_requested });
+
+			// A block with padding can only be the last one, it is decoded separately
+			auto c_blocks = c_read / 4 * 4;
+			if (c_blocks > 0 && characters[c_blocks - 1] == '=')
+				c_blocks -= 4;
+			if (!details::decode_base64_blocks(characters, c_blocks, data.data()))
+				throw_invalid_character({ characters, c_blocks });
+			data.remove_front(c_blocks / 4 * 3);
+			if (c_blocks == c_read)
+				return c_read == c_requested;
+
+			// Decode what's left (the end of the stream, or a padded block that has to be at the end of the stream)
+			for (auto left = const_buffer_ref{ characters + c_blocks, c_read - c_blocks }; !left.empty();)
+			{
+				auto block = left.remove_front(std::min<size_t>(left.size(), 4));
+				data.remove_front(deserialize_up_to_4_characters(block.data(), block.size(), data.data(), !left.empty() /*followed_by_characters*/));
+			}
+			return false;
+		}
+		// Throws the same error the blocks would have produced if they had been decoded one at a time
+		void throw_invalid_character(const_buffer_ref characters)
+		{
+			for (; !characters.empty(); characters.remove_front(4))
+			{
+				if (characters[3] == '=')
+					throw ill_formatted_base64_data{ "'=' is only allowed at the end of a base64 stream" };
+				for (size_t i = 0; i < 4; ++i)
+					character_to_6bits(characters[i]);
+			}
+			assert(false);
+			throw ill_formatted_base64_data{ "Invalid character in base64 stream" };
+		}
+
+		// Read up to 4 characters (or the end of stream) and decode them
 		uint8_t deserialize_up_to_3_bytes(buffer_ref output)
 		{
 			byte buffer[4];
 			auto c_read = read_full_buffer(m_stream, buffer);
+			return deserialize_up_to_4_characters(buffer, c_read, output.data(), false /*followed_by_characters*/);
+		}
+
+		// Remove the potential padding (base64 can be padded with '=' characters at the end) and generate up to 3 bytes of data
+		// from c_read characters (c_read < 4 only at the end of the stream)
+		// followed_by_characters is true if more characters of the stream have already been read after these ones
+		uint8_t deserialize_up_to_4_characters(const byte* buffer, size_t c_read, byte* output, bool followed_by_characters)
+		{
 			if (c_read == 4 && buffer[3] == '=') // Presence of padding means the stream is made of blocks of 4 bytes
 			{
 				if (buffer[2] == '=')
@@ -57,7 +330,7 @@ namespace goldfish { namespace stream
 				else
 					c_read = 3;
 
-				if (stream::seek(m_stream, 1) != 0)
+				if (followed_by_characters || stream::seek(m_stream, 1) != 0)
 					throw ill_formatted_base64_data{ "'=' is only allowed at the end of a base64 stream" };
 			}
 
@@ -91,36 +364,7 @@ namespace goldfish { namespace stream
 		}
 		byte character_to_6bits(byte c)
 		{
-			static const byte lookup_table[] = {
-				64,64,64,64,64,64,64,64,64,64,
-				64,64,64,64,64,64,64,64,64,64,
-				64,64,64,64,64,64,64,64,64,64,
-				64,64,64,64,64,64,64,64,64,64,
-				64,64,64,62,64,64,64,63,52,53,
-				54,55,56,57,58,59,60,61,64,64,
-				64,65,64,64,64, 0, 1, 2, 3, 4,
-				 5, 6, 7, 8, 9,10,11,12,13,14,
-				15,16,17,18,19,20,21,22,23,24,
-				25,64,64,64,64,64,64,26,27,28,
-				29,30,31,32,33,34,35,36,37,38,
-				39,40,41,42,43,44,45,46,47,48,
-				49,50,51,64,64,64,64,64,64,64,
-				64,64,64,64,64,64,64,64,64,64,
-				64,64,64,64,64,64,64,64,64,64,
-				64,64,64,64,64,64,64,64,64,64,
-				64,64,64,64,64,64,64,64,64,64,
-				64,64,64,64,64,64,64,64,64,64,
-				64,64,64,64,64,64,64,64,64,64,
-				64,64,64,64,64,64,64,64,64,64,
-				64,64,64,64,64,64,64,64,64,64,
-				64,64,64,64,64,64,64,64,64,64,
-				64,64,64,64,64,64,64,64,64,64,
-				64,64,64,64,64,64,64,64,64,64,
-				64,64,64,64,64,64,64,64,64,64,
-				64,64,64,64,64,64
-			};
-			static_assert(sizeof(lookup_table) == 256, "");
-			auto result = lookup_table[c];
+			auto result = details::base64_character_to_6bits(c);
 			if (result >= 64)
 				throw ill_formatted_base64_data{ "Invalid character in base64 stream" };
 			return result;
@@ -168,10 +412,13 @@ namespace goldfish { namespace stream
 				m_cb_pending_encoding = 0;
 			}
 
+			// Encode the complete triplets in blocks and write them to the inner stream in one go
 			while (data.size() >= 3)
 			{
-				write_triplet(data[0], data[1], data[2]);
-				data.remove_front(3);
+				byte characters[typical_buffer_length];
+				auto block = data.remove_front(std::min<size_t>(data.size() / 3, sizeof(characters) / 4) * 3);
+				details::encode_base64_blocks(block.data(), block.size(), characters);
+				m_stream.write_buffer({ characters, block.size() / 3 * 4 });
 			}
 
 			std::copy(data.begin(), data.end(), m_pending_encoding.begin());
@@ -194,11 +441,7 @@ namespace goldfish { namespace stream
 	private:
 		byte character_from_6bits(byte x)
 		{
-			static const char table[65] =
-				"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-				"abcdefghijklmnopqrstuvwxyz"
-				"0123456789+/";
-			return static_cast<byte>(table[x]);
+			return details::base64_character_from_6bits(x);
 		}
 		void write_triplet(uint32_t a, uint32_t b, uint32_t c)
 		{
@@ -4,9 +4,12 @@
 
 namespace goldfish { namespace stream
 {
-	template <size_t N, class inner> class buffered_reader
+	// The instrumentation policy (see instrumentation.h) defaults to the one of the inner stream
+	template <size_t N, class inner, class policy = instrumentation::policy_of_t<inner>> class buffered_reader
 	{
 	public:
+		using instrumentation_policy = policy;
+
 		buffered_reader(inner&& stream)
 			: m_stream(std::move(stream))
 		{}
@@ -33,12 +36,25 @@ namespace goldfish { namespace stream
 				return 0;
 
 			if (m_buffered.empty())
-				fill_in_buffer();
+				return read_partial_buffer_from_inner(data, has_read_view<inner>());
 
 			auto cb = std::min(m_buffered.size(), data.size());
 			copy(m_buffered.remove_front(cb), buffer_ref{ data.begin(), cb });
 			return cb;
 		}
+		const_buffer_ref read_view(size_t max)
+		{
+			if (m_buffered.empty())
+				return read_view_from_inner(max, has_read_view<inner>());
+			return{ m_buffered.data(), std::min(max, m_buffered.size()) };
+		}
+		void consume(size_t cb)
+		{
+			if (m_buffered.empty())
+				consume_from_inner(cb, has_read_view<inner>());
+			else
+				m_buffered.remove_front(cb);
+		}
 
 		uint64_t seek(uint64_t x)
 		{
@@ -49,7 +65,9 @@ namespace goldfish { namespace stream
 			}
 			else
 			{
-				auto skipped = m_buffered.size() + stream::seek(m_stream, x - m_buffered.size());
+				auto skipped_in_inner = stream::seek(m_stream, x - m_buffered.size());
+				instrumentation::record<policy>(instrumentation::event::bytes_skipped, skipped_in_inner);
+				auto skipped = m_buffered.size() + skipped_in_inner;
 				m_buffered.clear();
 				return skipped;
 			}
@@ -94,20 +112,57 @@ namespace goldfish { namespace stream
 			return t;
 		}
 
+		// When the inner stream exposes its data in memory, bypass our buffer (but still read at most N bytes, as if the buffer was used)
+		size_t read_partial_buffer_from_inner(buffer_ref data, std::true_type /*has_read_view*/)
+		{
+			auto view = m_stream.read_view(std::min(data.size(), N));
+			copy(view, buffer_ref{ data.begin(), view.size() });
+			m_stream.consume(view.size());
+			instrumentation::record<policy>(instrumentation::event::bytes_read, view.size());
+			return view.size();
+		}
+		size_t read_partial_buffer_from_inner(buffer_ref data, std::false_type /*has_read_view*/)
+		{
+			fill_in_buffer();
+			auto cb = std::min(m_buffered.size(), data.size());
+			copy(m_buffered.remove_front(cb), buffer_ref{ data.begin(), cb });
+			return cb;
+		}
+		const_buffer_ref read_view_from_inner(size_t max, std::true_type /*has_read_view*/) { return m_stream.read_view(max); }
+		const_buffer_ref read_view_from_inner(size_t max, std::false_type /*has_read_view*/)
+		{
+			if (max == 0)
+				return{};
+			fill_in_buffer();
+			return{ m_buffered.data(), std::min(max, m_buffered.size()) };
+		}
+		void consume_from_inner(size_t cb, std::true_type /*has_read_view*/)
+		{
+			m_stream.consume(cb);
+			instrumentation::record<policy>(instrumentation::event::bytes_read, cb);
+		}
+		void consume_from_inner(size_t cb, std::false_type /*has_read_view*/) { assert(cb == 0); }
+
 		void fill_in_buffer()
 		{
 			assert(m_buffered.empty());
 			m_buffered = { m_buffer_data.data(), m_stream.read_partial_buffer(m_buffer_data) };
+			instrumentation::record<policy>(instrumentation::event::buffer_refills);
+			instrumentation::record<policy>(instrumentation::event::bytes_read, m_buffered.size());
 		}
 		bool try_fill_in_buffer_ensure_size(size_t s)
 		{
 			assert(s <= N);
+			if (m_buffered.data() != m_buffer_data.data())
+				instrumentation::record<policy>(instrumentation::event::buffer_memmove_bytes, m_buffered.size());
 			memmove(m_buffer_data.data(), m_buffered.data(), m_buffered.size());
 			m_buffered = { m_buffer_data.data(), m_buffered.size() };
 
 			while (m_buffered.size() < s)
 			{
 				auto cb = m_stream.read_partial_buffer({ m_buffered.end(), m_buffer_data.data() + N });
+				instrumentation::record<policy>(instrumentation::event::buffer_refills);
+				instrumentation::record<policy>(instrumentation::event::bytes_read, cb);
 				if (cb == 0)
 					return false;
 				m_buffered = { m_buffered.begin(), m_buffered.end() + cb };
@@ -126,10 +181,12 @@ namespace goldfish { namespace stream
 		std::array<byte, N> m_buffer_data;
 	};
 
-	template <size_t N, class inner>
+	template <size_t N, class inner, class policy = instrumentation::policy_of_t<inner>>
 	class buffered_writer
 	{
 	public:
+		using instrumentation_policy = policy;
+
 		buffered_writer(inner&& stream)
 			: m_stream(std::move(stream))
 			, m_begin_free_space(m_buffer_data.data())
@@ -165,10 +222,27 @@ namespace goldfish { namespace stream
 			assert(m_begin_free_space == m_buffer_data.data());
 
 			if (data.size() >= m_buffer_data.size())
+			{
 				m_stream.write_buffer(data);
+				instrumentation::record<policy>(instrumentation::event::writer_flushes);
+				instrumentation::record<policy>(instrumentation::event::bytes_written, data.size());
+			}
 			else
 				m_begin_free_space = std::copy(data.begin(), data.end(), m_begin_free_space);
 		}
+		// Only available if a token of max_reserve_size bytes fits in the buffer
+		template <size_t n = N> std::enable_if_t<(n >= max_reserve_size), byte*> reserve(size_t cb)
+		{
+			assert(cb <= max_reserve_size);
+			if (cb_free() < cb)
+				send_data();
+			return m_begin_free_space;
+		}
+		template <size_t n = N> std::enable_if_t<(n >= max_reserve_size), void> commit(size_t cb)
+		{
+			assert(cb <= cb_free());
+			m_begin_free_space += cb;
+		}
 		auto flush()
 		{
 			send_data();
@@ -196,6 +270,8 @@ namespace goldfish { namespace stream
 				m_buffer_data.data(),
 				m_begin_free_space
 			});
+			instrumentation::record<policy>(instrumentation::event::writer_flushes);
+			instrumentation::record<policy>(instrumentation::event::bytes_written, m_begin_free_space - m_buffer_data.data());
 			m_begin_free_space = m_buffer_data.data();
 		}
 		std::array<byte, N> m_buffer_data;
@@ -204,4 +280,8 @@ namespace goldfish { namespace stream
 	};
 	template <size_t N, class inner> enable_if_reader_t<inner, buffered_reader<N, std::decay_t<inner>>> buffer(inner&& stream) { return{ std::forward<inner>(stream) }; }
 	template <size_t N, class inner> enable_if_writer_t<inner, buffered_writer<N, std::decay_t<inner>>> buffer(inner&& stream) { return{ std::forward<inner>(stream) }; }
+
+	// Same as above, with an explicit instrumentation policy (for example stream::buffer<8192, instrumentation::count_events>(stream))
+	template <size_t N, class policy, class inner> enable_if_reader_t<inner, buffered_reader<N, std::decay_t<inner>, policy>> buffer(inner&& stream) { return{ std::forward<inner>(stream) }; }
+	template <size_t N, class policy, class inner> enable_if_writer_t<inner, buffered_writer<N, std::decay_t<inner>, policy>> buffer(inner&& stream) { return{ std::forward<inner>(stream) }; }
 }}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common.h"
+#include <cstring>
 #include "debug_checks_reader.h"
 #include "match.h"
 #include "optional.h"
@@ -67,6 +68,24 @@ namespace goldfish { namespace cbor
 			return cb_read;
 		}
 
+		// The string can be read without copying if the underlying stream allows it
+		template <class S = Stream> std::enable_if_t<stream::has_read_view<S>::value, const_buffer_ref> read_view(size_t max)
+		{
+			if (max == 0 || !ensure_block())
+				return{};
+
+			auto view = m_stream.read_view(static_cast<size_t>(std::min<uint64_t>(max, m_remaining_in_current_block)));
+			if (view.empty())
+				throw ill_formatted_cbor_data{ "Unexpected end of stream while reading CBOR string" };
+			return view;
+		}
+		template <class S = Stream> std::enable_if_t<stream::has_read_view<S>::value, void> consume(size_t cb)
+		{
+			assert(cb <= m_remaining_in_current_block);
+			m_stream.consume(cb);
+			m_remaining_in_current_block -= cb;
+		}
+
 		uint64_t seek(uint64_t cb)
 		{
 			uint64_t original = cb;
@@ -379,13 +398,80 @@ namespace goldfish { namespace cbor
 			static_assert(sizeof(functions) / sizeof(functions[0]) == 256, "The jump table should have 256 entries");
 			return functions[first_byte](std::move(s), first_byte);
 		}
+
+		static optional<document<Stream>> read(Stream&& s, std::false_type /*has_read_view*/)
+		{
+			return read(std::move(s), stream::read<byte>(s));
+		}
+
+		// On streams that expose their data, the header and its argument (at most 9 bytes) are decoded from a single view
+		// so that the common cases (integers, short text strings, end of indefinite length containers) only need one bounds check
+		// Everything else goes through the jump table
+		static optional<document<Stream>> read(Stream&& s, std::true_type /*has_read_view*/)
+		{
+			auto view = s.read_view(9);
+			if (view.empty())
+				throw stream::unexpected_end_of_stream();
+
+			auto first_byte = view[0];
+			if (first_byte < 24)
+			{
+				s.consume(1);
+				return uint64_t{ first_byte };
+			}
+			if (first_byte < 28)
+			{
+				size_t cb_header = 1 + (size_t(1) << (first_byte - 24));
+				if (view.size() < cb_header)
+					return read_with_jump_table(std::move(s), first_byte);
+				auto argument = read_big_endian_argument(view.data() + 1, first_byte);
+				s.consume(cb_header);
+				return argument;
+			}
+			if (first_byte >= (1 << 5) && first_byte < ((1 << 5) | 24))
+			{
+				s.consume(1);
+				return -1 - static_cast<int64_t>(first_byte & 31);
+			}
+			if (first_byte >= (3 << 5) && first_byte < ((3 << 5) | 24))
+			{
+				s.consume(1);
+				return text_string<Stream>{ std::move(s), static_cast<uint64_t>(first_byte & 31) };
+			}
+			if (first_byte == 0xFF)
+			{
+				s.consume(1);
+				return nullopt;
+			}
+			return read_with_jump_table(std::move(s), first_byte);
+		}
+
+	private:
+		static uint64_t read_big_endian_argument(const byte* data, byte additional)
+		{
+			switch (additional & 31)
+			{
+			case 24: return *data;
+			case 25: { uint16_t x; memcpy(&x, data, sizeof(x)); return from_big_endian(x); }
+			case 26: { uint32_t x; memcpy(&x, data, sizeof(x)); return from_big_endian(x); }
+			default: { uint64_t x; memcpy(&x, data, sizeof(x)); return from_big_endian(x); }
+			}
+		}
+		static optional<document<Stream>> read_with_jump_table(Stream&& s, byte first_byte)
+		{
+			s.consume(1);
+			return read(std::move(s), first_byte);
+		}
 	};
 	template <class Stream> optional<document<std::decay_t<Stream>>> read_no_debug_check(Stream&& s)
 	{
 		static_assert(
 			!std::is_trivially_move_constructible<std::decay_t<Stream>>::value ||
 			std::is_trivially_move_constructible<document<std::decay_t<Stream>>>::value, "A cbor document on a trivially move constructible stream should be trivially move constructible");
-		return read_helper<std::decay_t<Stream>>::read(std::forward<Stream>(s), read<byte>(s));
+		auto d = read_helper<std::decay_t<Stream>>::read(std::forward<Stream>(s), stream::has_read_view<std::decay_t<Stream>>());
+		if (d)
+			instrumentation::record_document<instrumentation::policy_of_t<std::decay_t<Stream>>>(*d);
+		return d;
 	}
 
 	template <class Stream, class error_handler> auto read(Stream&& s, error_handler e)
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstring>
 #include <exception>
 #include "array_ref.h"
 #include "common.h"
@@ -12,32 +13,43 @@ namespace goldfish { namespace cbor
 {
 	namespace details
 	{
+		// Header byte followed by its big endian argument, written as a single token (see stream::write_token)
+		template <class T> byte* write_header(byte* output, byte header, T argument)
+		{
+			*(output++) = header;
+			argument = to_big_endian(argument);
+			memcpy(output, &argument, sizeof(argument));
+			return output + sizeof(argument);
+		}
 		template <byte major, class Stream> void write_integer(Stream& s, uint64_t x)
 		{
 			if (x <= 23)
 			{
 				stream::write(s, static_cast<byte>((major << 5) | x));
+				return;
 			}
-			else if (x <= std::numeric_limits<uint8_t>::max())
-			{
-				stream::write(s, static_cast<byte>((major << 5) | 24));
-				stream::write(s, static_cast<uint8_t>(x));
-			}
-			else if (x <= std::numeric_limits<uint16_t>::max())
-			{
-				stream::write(s, static_cast<byte>((major << 5) | 25));
-				stream::write(s, to_big_endian(static_cast<uint16_t>(x)));
-			}
-			else if (x <= std::numeric_limits<uint32_t>::max())
-			{
-				stream::write(s, static_cast<byte>((major << 5) | 26));
-				stream::write(s, to_big_endian(static_cast<uint32_t>(x)));
-			}
-			else
+
+			stream::write_token<9>(s, [&](byte* output)
 			{
-				stream::write(s, static_cast<byte>((major << 5) | 27));
-				stream::write(s, to_big_endian(x));
-			}
+				if (x <= std::numeric_limits<uint8_t>::max())
+				{
+					output[0] = static_cast<byte>((major << 5) | 24);
+					output[1] = static_cast<byte>(x);
+					return output + 2;
+				}
+				else if (x <= std::numeric_limits<uint16_t>::max())
+				{
+					return write_header(output, static_cast<byte>((major << 5) | 25), static_cast<uint16_t>(x));
+				}
+				else if (x <= std::numeric_limits<uint32_t>::max())
+				{
+					return write_header(output, static_cast<byte>((major << 5) | 26), static_cast<uint32_t>(x));
+				}
+				else
+				{
+					return write_header(output, static_cast<byte>((major << 5) | 27), x);
+				}
+			});
 		}
 	}
 	
@@ -89,17 +101,15 @@ namespace goldfish { namespace cbor
 				return write(static_cast<float>(x));
 
 			static_assert(sizeof(double) == sizeof(uint64_t), "Expect 64 bit doubles");
-			stream::write(m_stream, static_cast<byte>((7 << 5) | 27));
 			auto i = *reinterpret_cast<uint64_t*>(&x);
-			stream::write(m_stream, to_big_endian(i));
+			stream::write_token<9>(m_stream, [&](byte* output) { return details::write_header(output, static_cast<byte>((7 << 5) | 27), i); });
 			return m_stream.flush();
 		}
 		auto write(float x)
 		{
 			static_assert(sizeof(float) == sizeof(uint32_t), "Expect 32 bit floats");
-			stream::write(m_stream, static_cast<byte>((7 << 5) | 26));
 			auto i = *reinterpret_cast<uint32_t*>(&x);
-			stream::write(m_stream, to_big_endian(i));
+			stream::write_token<5>(m_stream, [&](byte* output) { return details::write_header(output, static_cast<byte>((7 << 5) | 26), i); });
 			return m_stream.flush();
 		}
 		auto write(undefined) 
@@ -126,6 +136,12 @@ namespace goldfish { namespace cbor
 			}
 		}
 
+		template <size_t N> auto write(const key<N>& k)
+		{
+			m_stream.write_buffer(k.cbor());
+			return m_stream.flush();
+		}
+
 		auto start_binary(uint64_t cb)
 		{
 			details::write_integer<2>(m_stream, cb);
@@ -3,14 +3,60 @@
 #include <cstdint>
 #include <iterator>
 #include <stdlib.h>
+#include <utility>
+
+// Vectorized code paths are selected at compile time, depending on the instruction sets the compiler is allowed to use
+// (for example -mavx2 or /arch:AVX2), with a scalar fallback
+#if defined(__AVX2__)
+	#define GOLDFISH_AVX2
+#endif
+#if defined(__SSE4_1__) || defined(__AVX__)
+	#define GOLDFISH_SSE4_1
+#endif
+#if defined(GOLDFISH_AVX2) || defined(GOLDFISH_SSE4_1)
+	#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
 
 namespace goldfish
 {
 	using byte = uint8_t;
 
+	#ifdef _MSC_VER
 	inline uint16_t from_big_endian(uint16_t x) { return _byteswap_ushort(x); }
 	inline uint32_t from_big_endian(uint32_t x) { return _byteswap_ulong(x); }
 	inline uint64_t from_big_endian(uint64_t x) { return _byteswap_uint64(x); }
+	#else
+	inline uint16_t from_big_endian(uint16_t x) { return __builtin_bswap16(x); }
+	inline uint32_t from_big_endian(uint32_t x) { return __builtin_bswap32(x); }
+	inline uint64_t from_big_endian(uint64_t x) { return __builtin_bswap64(x); }
+	#endif
+
+	// Index of the lowest bit set in x (x must not be 0), used to locate a byte in the mask returned by _mm_movemask_epi8
+	#ifdef _MSC_VER
+	inline unsigned count_trailing_zeros(uint32_t x) { unsigned long index; _BitScanForward(&index, x); return index; }
+	#else
+	inline unsigned count_trailing_zeros(uint32_t x) { return __builtin_ctz(x); }
+	#endif
+	inline unsigned count_trailing_zeros(uint64_t x)
+	{
+		auto low = static_cast<uint32_t>(x);
+		return low != 0 ? count_trailing_zeros(low) : 32 + count_trailing_zeros(static_cast<uint32_t>(x >> 32));
+	}
+
+	// Number of 0 bits above the highest bit set in x (x must not be 0)
+	#ifdef _MSC_VER
+	inline unsigned count_leading_zeros(uint32_t x) { unsigned long index; _BitScanReverse(&index, x); return 31 - index; }
+	#else
+	inline unsigned count_leading_zeros(uint32_t x) { return __builtin_clz(x); }
+	#endif
+	inline unsigned count_leading_zeros(uint64_t x)
+	{
+		auto high = static_cast<uint32_t>(x >> 32);
+		return high != 0 ? count_leading_zeros(high) : 32 + count_leading_zeros(static_cast<uint32_t>(x));
+	}
 
 	inline uint16_t to_big_endian(uint16_t x) { return from_big_endian(x); }
 	inline uint32_t to_big_endian(uint32_t x) { return from_big_endian(x); }
@@ -49,8 +95,13 @@ namespace goldfish
 
 	// VC++ has a make_unchecked_array_iterator API to allow using raw iterators in APIs like std::copy or std::equal
 	// We implement our own that forwards to VC++ implementation or is identity depending on the compiler
+	#ifdef _MSC_VER
 	template <class T> auto make_unchecked_array_iterator(T&& t) { return stdext::make_unchecked_array_iterator(std::forward<T>(t)); }
 	template <class T> auto get_array_iterator_from_unchecked(T&& t) { return t.base(); }
+	#else
+	template <class T> auto make_unchecked_array_iterator(T&& t) { return std::forward<T>(t); }
+	template <class T> auto get_array_iterator_from_unchecked(T&& t) { return std::forward<T>(t); }
+	#endif
 
 	template <size_t...> struct largest {};
 	template <size_t x> struct largest<x> { enum { value = x }; };
@@ -12,20 +12,25 @@ namespace goldfish { namespace debug_checks
 	template <class error_handler, class T> class array;
 	template <class error_handler, class T> class map;
 
-	template <class error_handler, class Document> struct document : document_impl<
-		Document::does_json_conversions,
-		bool,
-		nullptr_t,
-		uint64_t,
-		int64_t,
-		double,
-		undefined,
-		string<error_handler, typename Document::template type_with_tag_t<tags::string>, tags::string>,
-		string<error_handler, typename Document::template type_with_tag_t<tags::binary>, tags::binary>,
-		array<error_handler, typename Document::template type_with_tag_t<tags::array>>,
-		map<error_handler, typename Document::template type_with_tag_t<tags::map>>>
+	namespace details
 	{
-		using document_impl::document_impl;
+		// Strings, arrays and maps of the inner document are wrapped to check their usage, other types are left as is
+		template <class error_handler, class T, class tag = tags::tag_t<T>> struct checked { using type = T; };
+		template <class error_handler, class T> struct checked<error_handler, T, tags::string> { using type = string<error_handler, T, tags::string>; };
+		template <class error_handler, class T> struct checked<error_handler, T, tags::binary> { using type = string<error_handler, T, tags::binary>; };
+		template <class error_handler, class T> struct checked<error_handler, T, tags::array> { using type = array<error_handler, T>; };
+		template <class error_handler, class T> struct checked<error_handler, T, tags::map> { using type = map<error_handler, T>; };
+
+		template <class error_handler> struct checked_document
+		{
+			template <bool does_json_conversions, class... types> using type = document_impl<does_json_conversions, typename checked<error_handler, types>::type...>;
+		};
+	}
+
+	template <class error_handler, class Document> struct document : Document::template rebind_t<details::checked_document<error_handler>>
+	{
+		using base = typename Document::template rebind_t<details::checked_document<error_handler>>;
+		using base::base;
 	};
 
 	template <class error_handler, class Document> document<error_handler, std::decay_t<Document>> add_read_checks_impl(container_base<error_handler>* parent, Document&& t);
@@ -56,6 +61,22 @@ namespace goldfish { namespace debug_checks
 				unlock_parent();
 			return skipped;
 		}
+		template <class U = T> std::enable_if_t<stream::has_read_view<U>::value, const_buffer_ref> read_view(size_t max)
+		{
+			auto result = m_inner.read_view(max);
+			if (result.empty() && max > 0)
+				unlock_parent();
+			return result;
+		}
+		template <class U = T> std::enable_if_t<stream::has_read_view<U>::value, void> consume(size_t cb)
+		{
+			m_inner.consume(cb);
+		}
+		template <class U = T> std::enable_if_t<goldfish::details::has_seek_to_end<U>::value, void> seek_to_end()
+		{
+			m_inner.seek_to_end();
+			this->unlock_parent();
+		}
 	private:
 		T m_inner;
 	};
@@ -86,6 +107,12 @@ namespace goldfish { namespace debug_checks
 				return nullopt;
 			}
 		}
+		template <class U = T> std::enable_if_t<goldfish::details::has_seek_to_end<U>::value, void> seek_to_end()
+		{
+			this->err_if_locked();
+			m_inner.seek_to_end();
+			this->unlock_parent();
+		}
 	private:
 		T m_inner;
 	};
@@ -125,6 +152,14 @@ namespace goldfish { namespace debug_checks
 			clear_flag();
 			return add_read_checks_impl(this /*parent*/, m_inner.read_value());
 		}
+		// Can be called between a key and its value
+		template <class U = T> std::enable_if_t<goldfish::details::has_seek_to_end<U>::value, void> seek_to_end()
+		{
+			this->err_if_locked();
+			this->clear_flag();
+			m_inner.seek_to_end();
+			this->unlock_parent();
+		}
 	private:
 		T m_inner;
 	};
@@ -183,7 +183,7 @@ namespace goldfish { namespace debug_checks
 			: container_base<error_handler>(parent)
 			, m_writer(std::move(writer))
 		{}
-		template <class T> auto write(T&& t)
+		template <class T> auto write(T&& t) -> decltype(std::declval<inner&>().write(std::forward<T>(t)))
 		{
 			err_if_locked();
 			unlock_parent_and_lock_self();
@@ -2,7 +2,20 @@
 
 #include "array_ref.h"
 #include "common.h"
+#include "stream.h"
+#include <errno.h>
+#include <stdio.h>
 #include <string>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+	#include <io.h>
+#else
+	#include <fcntl.h>
+	#include <new>
+	#include <stdlib.h>
+	#include <unistd.h>
+#endif
 
 namespace goldfish { namespace stream
 {
@@ -13,20 +26,28 @@ namespace goldfish { namespace stream
 		public:
 			file_handle(const char* path, const char* mode)
 			{
+				#ifdef _WIN32
 				if (auto error = fopen_s(&m_fp, path, mode))
 					throw io_exception_with_error_code{ "Error during file open", error };
+				#else
+				m_fp = fopen(path, mode);
+				if (!m_fp)
+					throw io_exception_with_error_code{ "Error during file open", errno };
+				#endif
 			}
+			file_handle(const std::string& path, const char* mode)
+				: file_handle(path.c_str(), mode)
+			{}
+			#ifdef _WIN32
 			file_handle(const wchar_t* path, const wchar_t* wmode)
 			{
 				if (auto error = _wfopen_s(&m_fp, path, wmode))
 					throw io_exception_with_error_code{ "Error during file open", error };
 			}
-			file_handle(const std::string& path, const char* mode)
-				: file_handle(path.c_str(), mode)
-			{}
 			file_handle(const std::wstring& path, const wchar_t* wmode)
 				: file_handle(path.c_str(), wmode)
 			{}
+			#endif
 
 			file_handle(file_handle&& rhs)
 				: m_fp(rhs.m_fp)
@@ -45,6 +66,27 @@ namespace goldfish { namespace stream
 		private:
 			FILE* m_fp;
 		};
+
+		// Number of bytes that can be skipped from the current position of a regular file
+		// Returns false if the file is not a regular file (pipe, terminal...) and can't be seeked
+		inline bool file_bytes_left(FILE* fp, uint64_t& result)
+		{
+			#ifdef _WIN32
+			struct _stat64 st;
+			if (_fstat64(_fileno(fp), &st) != 0 || (st.st_mode & _S_IFMT) != _S_IFREG)
+				return false;
+			auto position = _ftelli64(fp);
+			#else
+			struct stat st;
+			if (fstat(fileno(fp), &st) != 0 || !S_ISREG(st.st_mode))
+				return false;
+			auto position = ftello(fp);
+			#endif
+			if (position < 0)
+				return false;
+			result = static_cast<uint64_t>(st.st_size) > static_cast<uint64_t>(position) ? static_cast<uint64_t>(st.st_size) - position : 0;
+			return true;
+		}
 	}
 
 	class file_reader
@@ -53,15 +95,17 @@ namespace goldfish { namespace stream
 		file_reader(const char* path)
 			: m_file(path, "rb")
 		{}
-		file_reader(const wchar_t* path)
-			: m_file(path, L"rb")
-		{}
 		file_reader(const std::string& path)
 			: m_file(path, "rb")
 		{}
+		#ifdef _WIN32
+		file_reader(const wchar_t* path)
+			: m_file(path, L"rb")
+		{}
 		file_reader(const std::wstring& path)
 			: m_file(path, L"rb")
 		{}
+		#endif
 		size_t read_partial_buffer(buffer_ref data)
 		{
 			auto cb = fread(data.data(), 1 /*size*/, data.size() /*count*/, m_file.get());
@@ -72,6 +116,24 @@ namespace goldfish { namespace stream
 			}
 			return cb;
 		}
+
+		// Regular files are seeked without reading the data skipped over (so skipping large values is O(1) IO)
+		uint64_t seek(uint64_t x)
+		{
+			uint64_t cb_left;
+			if (!details::file_bytes_left(m_file.get(), cb_left))
+				return details::seek_by_reading(*this, x);
+
+			auto cb = std::min(x, cb_left);
+			#ifdef _WIN32
+			auto error = _fseeki64(m_file.get(), static_cast<int64_t>(cb), SEEK_CUR);
+			#else
+			auto error = fseeko(m_file.get(), static_cast<off_t>(cb), SEEK_CUR);
+			#endif
+			if (error != 0)
+				throw io_exception_with_error_code{ "Error during file seek", errno };
+			return cb;
+		}
 	private:
 		details::file_handle m_file;
 	};
@@ -82,15 +144,17 @@ namespace goldfish { namespace stream
 		file_writer(const char* path)
 			: m_file(path, "wb")
 		{}
-		file_writer(const wchar_t* path)
-			: m_file(path, L"wb")
-		{}
 		file_writer(const std::string& path)
 			: m_file(path, "wb")
 		{}
+		#ifdef _WIN32
+		file_writer(const wchar_t* path)
+			: m_file(path, L"wb")
+		{}
 		file_writer(const std::wstring& path)
 			: m_file(path, L"wb")
 		{}
+		#endif
 
 		void write_buffer(const_buffer_ref data)
 		{
@@ -101,4 +165,256 @@ namespace goldfish { namespace stream
 	private:
 		details::file_handle m_file;
 	};
+
+	#ifndef _WIN32
+	// Whether an fd_reader or fd_writer closes its file descriptor when destroyed
+	enum class fd_ownership
+	{
+		owned,
+		borrowed,
+	};
+
+	namespace details
+	{
+		class fd_handle
+		{
+		public:
+			fd_handle(const char* path, int flags)
+				: m_fd(::open(path, flags | O_CLOEXEC, 0666))
+				, m_ownership(fd_ownership::owned)
+			{
+				if (m_fd < 0)
+					throw io_exception_with_error_code{ "Error during file open", errno };
+			}
+			fd_handle(int fd, fd_ownership ownership)
+				: m_fd(fd)
+				, m_ownership(ownership)
+			{}
+			fd_handle(fd_handle&& rhs)
+				: m_fd(rhs.m_fd)
+				, m_ownership(rhs.m_ownership)
+			{
+				rhs.m_fd = -1;
+			}
+			~fd_handle()
+			{
+				if (m_fd >= 0 && m_ownership == fd_ownership::owned)
+					::close(m_fd);
+			}
+			fd_handle(const fd_handle&) = delete;
+			fd_handle& operator = (const fd_handle&) = delete;
+
+			int get() const { return m_fd; }
+		private:
+			int m_fd;
+			fd_ownership m_ownership;
+		};
+
+		// Page aligned heap buffer, so that the kernel can copy in and out of it efficiently
+		class aligned_buffer
+		{
+		public:
+			aligned_buffer(size_t size)
+				: m_size(size)
+			{
+				void* p;
+				if (posix_memalign(&p, 4096, size) != 0)
+					throw std::bad_alloc();
+				m_data = static_cast<byte*>(p);
+			}
+			aligned_buffer(aligned_buffer&& rhs)
+				: m_data(rhs.m_data)
+				, m_size(rhs.m_size)
+			{
+				rhs.m_data = nullptr;
+			}
+			~aligned_buffer()
+			{
+				free(m_data);
+			}
+			aligned_buffer(const aligned_buffer&) = delete;
+			aligned_buffer& operator = (const aligned_buffer&) = delete;
+
+			byte* data() const { return m_data; }
+			size_t size() const { return m_size; }
+		private:
+			byte* m_data;
+			size_t m_size;
+		};
+
+		inline size_t read_fd(int fd, buffer_ref data)
+		{
+			for (;;)
+			{
+				auto cb = ::read(fd, data.data(), data.size());
+				if (cb >= 0)
+					return static_cast<size_t>(cb);
+				if (errno != EINTR)
+					throw io_exception_with_error_code{ "Error during file read", errno };
+			}
+		}
+		inline void write_fd(int fd, const_buffer_ref data)
+		{
+			while (!data.empty())
+			{
+				auto cb = ::write(fd, data.data(), data.size());
+				if (cb >= 0)
+					data.remove_front(static_cast<size_t>(cb));
+				else if (errno != EINTR)
+					throw io_exception_with_error_code{ "Error during file write", errno };
+			}
+		}
+	}
+
+	// Size of the buffer used by fd_reader and fd_writer
+	static const size_t fd_buffer_length = 64 * 1024;
+
+	// Reader on a POSIX file descriptor, using read(2) directly (no stdio locking and no stdio buffer)
+	// Small reads are served from a large internal buffer, reads larger than that buffer go straight to the file descriptor
+	class fd_reader
+	{
+	public:
+		fd_reader(const char* path)
+			: m_fd(path, O_RDONLY)
+		{}
+		fd_reader(const std::string& path)
+			: fd_reader(path.c_str())
+		{}
+		fd_reader(int fd, fd_ownership ownership)
+			: m_fd(fd, ownership)
+		{}
+		fd_reader(fd_reader&& rhs)
+			: m_fd(std::move(rhs.m_fd))
+			, m_buffer(std::move(rhs.m_buffer))
+			, m_buffered(rhs.m_buffered)
+		{
+			rhs.m_buffered = {};
+		}
+		fd_reader(const fd_reader&) = delete;
+		fd_reader& operator = (const fd_reader&) = delete;
+		fd_reader& operator = (fd_reader&&) = delete;
+
+		size_t read_partial_buffer(buffer_ref data)
+		{
+			if (data.empty())
+				return 0;
+
+			if (m_buffered.empty())
+			{
+				if (data.size() >= fd_buffer_length)
+					return details::read_fd(m_fd.get(), data);
+
+				m_buffered = { m_buffer.data(), details::read_fd(m_fd.get(), { m_buffer.data(), m_buffer.size() }) };
+			}
+
+			auto cb = std::min(m_buffered.size(), data.size());
+			copy(m_buffered.remove_front(cb), data.remove_front(cb));
+			return cb;
+		}
+
+		// Regular files are seeked using lseek, without reading the data skipped over
+		uint64_t seek(uint64_t x)
+		{
+			auto cb_buffered = static_cast<size_t>(std::min<uint64_t>(x, m_buffered.size()));
+			m_buffered.remove_front(cb_buffered);
+			x -= cb_buffered;
+			if (x == 0)
+				return cb_buffered;
+
+			struct stat st;
+			auto position = ::lseek(m_fd.get(), 0, SEEK_CUR);
+			if (position < 0 || fstat(m_fd.get(), &st) != 0 || !S_ISREG(st.st_mode))
+				return cb_buffered + details::seek_by_reading(*this, x);
+
+			auto cb = std::min<uint64_t>(x, st.st_size > position ? st.st_size - position : 0);
+			if (::lseek(m_fd.get(), static_cast<off_t>(cb), SEEK_CUR) < 0)
+				throw io_exception_with_error_code{ "Error during file seek", errno };
+			return cb_buffered + cb;
+		}
+	private:
+		details::fd_handle m_fd;
+		details::aligned_buffer m_buffer{ fd_buffer_length };
+		buffer_ref m_buffered;
+	};
+
+	// Writer on a POSIX file descriptor, using write(2) directly (no stdio locking and no stdio buffer)
+	// Small writes are accumulated in a large internal buffer, that buffer is written out when full or when flush is called
+	// Data still buffered when the writer is destroyed is written out, ignoring errors (call flush to get those errors)
+	class fd_writer
+	{
+	public:
+		fd_writer(const char* path)
+			: m_fd(path, O_WRONLY | O_CREAT | O_TRUNC)
+		{}
+		fd_writer(const std::string& path)
+			: fd_writer(path.c_str())
+		{}
+		fd_writer(int fd, fd_ownership ownership)
+			: m_fd(fd, ownership)
+		{}
+		fd_writer(fd_writer&& rhs)
+			: m_fd(std::move(rhs.m_fd))
+			, m_buffer(std::move(rhs.m_buffer))
+			, m_cb_buffered(rhs.m_cb_buffered)
+		{
+			rhs.m_cb_buffered = 0;
+		}
+		~fd_writer()
+		{
+			try
+			{
+				send_data();
+			}
+			catch (...)
+			{
+			}
+		}
+		fd_writer(const fd_writer&) = delete;
+		fd_writer& operator = (const fd_writer&) = delete;
+		fd_writer& operator = (fd_writer&&) = delete;
+
+		void write_buffer(const_buffer_ref data)
+		{
+			if (data.size() <= m_buffer.size() - m_cb_buffered)
+			{
+				copy(data, buffer_ref{ m_buffer.data() + m_cb_buffered, data.size() });
+				m_cb_buffered += data.size();
+				return;
+			}
+
+			send_data();
+			if (data.size() >= m_buffer.size())
+			{
+				details::write_fd(m_fd.get(), data);
+			}
+			else
+			{
+				copy(data, buffer_ref{ m_buffer.data(), data.size() });
+				m_cb_buffered = data.size();
+			}
+		}
+		void flush()
+		{
+			send_data();
+		}
+	private:
+		void send_data()
+		{
+			if (m_cb_buffered == 0)
+				return;
+
+			// Reset the buffer before writing so that a failed write isn't retried on destruction
+			auto cb = m_cb_buffered;
+			m_cb_buffered = 0;
+			details::write_fd(m_fd.get(), { m_buffer.data(), cb });
+		}
+
+		details::fd_handle m_fd;
+		details::aligned_buffer m_buffer{ fd_buffer_length };
+		size_t m_cb_buffered = 0;
+	};
+
+	inline fd_reader stdin_reader() { return{ STDIN_FILENO, fd_ownership::borrowed }; }
+	inline fd_writer stdout_writer() { return{ STDOUT_FILENO, fd_ownership::borrowed }; }
+	#endif
 }}
\ No newline at end of file
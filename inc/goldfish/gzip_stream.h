@@ -0,0 +1,156 @@
+#pragma once
+
+#include "array_ref.h"
+#include "common.h"
+#include "stream.h"
+
+#include <memory>
+#include <new>
+#include <zlib.h>
+
+// Requires zlib (https://zlib.net), the application needs to link against it
+namespace goldfish { namespace stream
+{
+	struct ill_formatted_gzip_data : ill_formatted { using ill_formatted::ill_formatted; };
+
+	// Size of the buffer holding the compressed data in gzip_reader and gzip_writer
+	static const size_t gzip_buffer_length = 64 * 1024;
+
+	namespace details
+	{
+		// zlib keeps a pointer to the z_stream in its internal state, so the z_stream can't move: it is allocated on the heap along with its buffer
+		struct zlib_state
+		{
+			z_stream z = {};
+			byte buffer[gzip_buffer_length];
+		};
+		struct inflate_deleter { void operator()(zlib_state* p) const { inflateEnd(&p->z); delete p; } };
+		struct deflate_deleter { void operator()(zlib_state* p) const { deflateEnd(&p->z); delete p; } };
+
+		// zlib counts bytes using 32 bits integers
+		inline uInt zlib_size(size_t cb) { return static_cast<uInt>(std::min<size_t>(cb, std::numeric_limits<uInt>::max())); }
+
+		inline void check_zlib_result(int result)
+		{
+			switch (result)
+			{
+			case Z_OK:
+			case Z_STREAM_END:
+			case Z_BUF_ERROR: // no progress possible, not fatal
+				return;
+			case Z_MEM_ERROR:
+				throw std::bad_alloc();
+			case Z_DATA_ERROR:
+			case Z_NEED_DICT:
+				throw ill_formatted_gzip_data{ "Invalid gzip data" };
+			default:
+				throw io_exception_with_error_code{ "zlib error", result };
+			}
+		}
+	}
+
+	// Reads the data decompressed from a gzip stream (zlib streams are also accepted)
+	// Concatenated gzip members (as produced by pigz or by appending gzip files) are read as a single stream
+	template <class inner> class gzip_reader
+	{
+	public:
+		gzip_reader(inner&& stream)
+			: m_stream(std::move(stream))
+		{
+			std::unique_ptr<details::zlib_state> state(new details::zlib_state);
+			details::check_zlib_result(inflateInit2(&state->z, 15 + 32 /*max window, detect gzip or zlib header*/));
+			m_state.reset(state.release());
+		}
+
+		size_t read_partial_buffer(buffer_ref data)
+		{
+			auto& z = m_state->z;
+			z.next_out = data.data();
+			z.avail_out = details::zlib_size(data.size());
+			while (z.avail_out > 0 && z.next_out == data.data())
+			{
+				if (z.avail_in == 0 && !fill_in_buffer())
+				{
+					if (m_in_member)
+						throw ill_formatted_gzip_data{ "Unexpected end of gzip stream" };
+					break;
+				}
+
+				m_in_member = true;
+				auto result = inflate(&z, Z_NO_FLUSH);
+				details::check_zlib_result(result);
+				if (result == Z_STREAM_END)
+				{
+					// Another member might follow
+					m_in_member = false;
+					details::check_zlib_result(inflateReset(&z));
+				}
+			}
+			return static_cast<size_t>(z.next_out - data.data());
+		}
+
+	private:
+		bool fill_in_buffer()
+		{
+			auto cb = m_stream.read_partial_buffer(m_state->buffer);
+			m_state->z.next_in = m_state->buffer;
+			m_state->z.avail_in = static_cast<uInt>(cb);
+			return cb > 0;
+		}
+
+		inner m_stream;
+		std::unique_ptr<details::zlib_state, details::inflate_deleter> m_state;
+		bool m_in_member = false;
+	};
+
+	// Compresses the data written to it in the gzip format before writing it to inner
+	// The gzip trailer is only written on flush
+	template <class inner> class gzip_writer
+	{
+	public:
+		gzip_writer(inner&& stream, int compression_level = Z_DEFAULT_COMPRESSION)
+			: m_stream(std::move(stream))
+		{
+			std::unique_ptr<details::zlib_state> state(new details::zlib_state);
+			details::check_zlib_result(deflateInit2(&state->z, compression_level, Z_DEFLATED, 15 + 16 /*max window, gzip header*/, 8, Z_DEFAULT_STRATEGY));
+			m_state.reset(state.release());
+		}
+
+		void write_buffer(const_buffer_ref data)
+		{
+			while (!data.empty())
+			{
+				auto cb = details::zlib_size(data.size());
+				m_state->z.next_in = const_cast<byte*>(data.data());
+				m_state->z.avail_in = cb;
+				while (m_state->z.avail_in > 0)
+					deflate_to_inner(Z_NO_FLUSH);
+				data.remove_front(cb);
+			}
+		}
+		auto flush()
+		{
+			while (deflate_to_inner(Z_FINISH) != Z_STREAM_END) {}
+			return m_stream.flush();
+		}
+
+	private:
+		int deflate_to_inner(int mode)
+		{
+			auto& z = m_state->z;
+			z.next_out = m_state->buffer;
+			z.avail_out = sizeof(m_state->buffer);
+			auto result = deflate(&z, mode);
+			details::check_zlib_result(result);
+			if (z.next_out != m_state->buffer)
+				m_stream.write_buffer({ m_state->buffer, static_cast<size_t>(z.next_out - m_state->buffer) });
+			return result;
+		}
+
+		inner m_stream;
+		std::unique_ptr<details::zlib_state, details::deflate_deleter> m_state;
+	};
+
+	template <class inner> enable_if_reader_t<inner, gzip_reader<std::decay_t<inner>>> decompress_gzip(inner&& stream) { return{ std::forward<inner>(stream) }; }
+	template <class inner> enable_if_writer_t<inner, gzip_writer<std::decay_t<inner>>> compress_gzip_to(inner&& stream, int compression_level = Z_DEFAULT_COMPRESSION) { return{ std::forward<inner>(stream), compression_level }; }
+}}
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include "tags.h"
+
+namespace goldfish { namespace instrumentation
+{
+	// Events reported to the instrumentation policy
+	enum class event
+	{
+		// A document of the given type was parsed (by json::read, cbor::read or while reading arrays and maps)
+		// (number_document is a number kept as text, see json::read_raw_numbers)
+		null_document,
+		boolean_document,
+		unsigned_int_document,
+		signed_int_document,
+		floating_point_document,
+		number_document,
+		undefined_document,
+		string_document,
+		binary_document,
+		array_document,
+		map_document,
+
+		bytes_read,          // bytes a buffered_reader read from its inner stream
+		bytes_skipped,       // bytes a buffered_reader skipped using seek
+		buffer_refills,      // number of reads a buffered_reader issued on its inner stream to refill its buffer
+		buffer_memmove_bytes,// bytes a buffered_reader moved to the front of its buffer to serve a read or peek that straddles the end of the buffer
+		writer_flushes,      // number of writes a buffered_writer issued on its inner stream
+		bytes_written,       // bytes a buffered_writer wrote to its inner stream
+
+		count
+	};
+
+	/* An instrumentation policy is a type with:
+	 - a static enabled member, false if the policy ignores all events (in which case instrumentation compiles to nothing)
+	 - a static on_event(event, uint64_t count) function
+	The policy is attached to a stream as a template parameter of buffered_reader and buffered_writer (see stream::buffer<N, policy>)
+	and flows from the stream to the readers and writers built on top of it */
+	struct none
+	{
+		enum { enabled = false };
+		static void on_event(event, uint64_t) {}
+	};
+
+	// Counts events per thread
+	struct counters
+	{
+		uint64_t operator[](event e) const { return values[static_cast<size_t>(e)]; }
+		void reset() { values = {}; }
+		std::array<uint64_t, static_cast<size_t>(event::count)> values = {};
+	};
+	struct count_events
+	{
+		enum { enabled = true };
+		static void on_event(event e, uint64_t count) { get().values[static_cast<size_t>(e)] += count; }
+		static counters& get()
+		{
+			static thread_local counters c;
+			return c;
+		}
+	};
+
+	#ifndef GOLDFISH_DEFAULT_INSTRUMENTATION_POLICY
+		#define GOLDFISH_DEFAULT_INSTRUMENTATION_POLICY none
+	#endif
+	using default_policy = GOLDFISH_DEFAULT_INSTRUMENTATION_POLICY;
+
+	// Streams expose the policy they use with an instrumentation_policy member type, streams without one use the default policy
+	template <class T> static typename T::instrumentation_policy test_policy_of(typename T::instrumentation_policy*) { return{}; }
+	template <class T> static default_policy test_policy_of(...) { return{}; }
+	template <class T> using policy_of_t = decltype(test_policy_of<T>(nullptr));
+
+	template <class policy> void record(event e, uint64_t count = 1)
+	{
+		if (policy::enabled)
+			policy::on_event(e, count);
+	}
+
+	inline event document_event(tags::null) { return event::null_document; }
+	inline event document_event(tags::boolean) { return event::boolean_document; }
+	inline event document_event(tags::unsigned_int) { return event::unsigned_int_document; }
+	inline event document_event(tags::signed_int) { return event::signed_int_document; }
+	inline event document_event(tags::floating_point) { return event::floating_point_document; }
+	inline event document_event(tags::number) { return event::number_document; }
+	inline event document_event(tags::undefined) { return event::undefined_document; }
+	inline event document_event(tags::string) { return event::string_document; }
+	inline event document_event(tags::binary) { return event::binary_document; }
+	inline event document_event(tags::array) { return event::array_document; }
+	inline event document_event(tags::map) { return event::map_document; }
+
+	template <class policy, class Document> void record_document(Document&, std::false_type /*enabled*/) {}
+	template <class policy, class Document> void record_document(Document& d, std::true_type /*enabled*/)
+	{
+		d.visit([](auto&, auto tag) { policy::on_event(document_event(tag), 1); });
+	}
+	template <class policy, class Document> void record_document(Document& d)
+	{
+		record_document<policy>(d, std::integral_constant<bool, policy::enabled>());
+	}
+}}
\ No newline at end of file
@@ -0,0 +1,525 @@
+#pragma once
+
+#ifdef __linux__
+
+#include "array_ref.h"
+#include "common.h"
+#include "file_stream.h"
+#include "stream.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <memory>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+
+namespace goldfish { namespace stream
+{
+	// Default number of reads or writes kept in flight by io_uring_reader and io_uring_writer, and size of each of them
+	static const unsigned default_io_uring_queue_depth = 8;
+	static const size_t default_io_uring_chunk_size = 128 * 1024;
+
+	namespace details
+	{
+		// Minimal wrapper around the io_uring system calls (submission and completion rings mapped in memory)
+		class io_uring_queue
+		{
+		public:
+			io_uring_queue(unsigned entries)
+			{
+				io_uring_params params;
+				memset(&params, 0, sizeof(params));
+				m_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+				if (m_fd < 0)
+					throw io_exception_with_error_code{ "Error while creating the io_uring", errno };
+
+				try
+				{
+					map(params);
+				}
+				catch (...)
+				{
+					release();
+					throw;
+				}
+			}
+			~io_uring_queue()
+			{
+				release();
+			}
+			io_uring_queue(const io_uring_queue&) = delete;
+			io_uring_queue& operator = (const io_uring_queue&) = delete;
+
+			int fd() const { return m_fd; }
+
+			// Queue a request, it is sent to the kernel on the next call to submit or wait
+			void push(const io_uring_sqe& sqe)
+			{
+				auto tail = *m_sq_tail;
+				assert(tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) < m_sq_entries);
+				auto index = tail & *m_sq_mask;
+				m_sqes[index] = sqe;
+				m_sq_array[index] = index;
+				__atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+				++m_to_submit;
+			}
+			void submit()
+			{
+				enter(0);
+			}
+			bool try_pop(io_uring_cqe& cqe)
+			{
+				auto head = *m_cq_head;
+				if (head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE))
+					return false;
+				cqe = m_cqes[head & *m_cq_mask];
+				__atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+				--m_in_flight;
+				return true;
+			}
+			io_uring_cqe wait()
+			{
+				io_uring_cqe cqe;
+				while (!try_pop(cqe))
+					enter(1);
+				return cqe;
+			}
+
+		private:
+			void map(const io_uring_params& params)
+			{
+				m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+				m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+				auto single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+				if (single_mmap)
+					m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+
+				m_sq_ring = map_region(m_sq_ring_size, IORING_OFF_SQ_RING);
+				m_cq_ring = single_mmap ? m_sq_ring : map_region(m_cq_ring_size, IORING_OFF_CQ_RING);
+				m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+				m_sqes = static_cast<io_uring_sqe*>(map_region(m_sqes_size, IORING_OFF_SQES));
+
+				auto sq = static_cast<byte*>(m_sq_ring);
+				m_sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+				m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+				m_sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+				m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+				m_sq_entries = params.sq_entries;
+
+				auto cq = static_cast<byte*>(m_cq_ring);
+				m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+				m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+				m_cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+				m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+			}
+			void* map_region(size_t size, off_t offset)
+			{
+				auto p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, offset);
+				if (p == MAP_FAILED)
+					throw io_exception_with_error_code{ "Error while mapping the io_uring", errno };
+				return p;
+			}
+			void release()
+			{
+				if (m_sqes)
+					munmap(m_sqes, m_sqes_size);
+				if (m_cq_ring && m_cq_ring != m_sq_ring)
+					munmap(m_cq_ring, m_cq_ring_size);
+				if (m_sq_ring)
+					munmap(m_sq_ring, m_sq_ring_size);
+				if (m_fd >= 0)
+					close(m_fd);
+			}
+			void enter(unsigned min_complete)
+			{
+				for (;;)
+				{
+					auto submitted = syscall(__NR_io_uring_enter, m_fd, m_to_submit, min_complete, min_complete ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+					if (submitted >= 0)
+					{
+						m_to_submit -= static_cast<unsigned>(submitted);
+						m_in_flight += static_cast<unsigned>(submitted);
+						if (m_to_submit == 0 || min_complete > 0)
+							return;
+					}
+					else if (errno == EAGAIN || errno == EBUSY)
+					{
+						// The kernel can't take more requests until some complete: rather than retrying right away,
+						// wait for one of the requests in flight to complete (the caller reaps it) or back off if there are none
+						// The requests not submitted stay in the ring, they are submitted by the next call
+						if (m_in_flight > 0)
+							syscall(__NR_io_uring_enter, m_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+						else
+							usleep(1000);
+						return;
+					}
+					else if (errno != EINTR)
+					{
+						throw io_exception_with_error_code{ "Error while submitting io_uring requests", errno };
+					}
+				}
+			}
+
+			int m_fd = -1;
+			unsigned m_to_submit = 0;
+			unsigned m_in_flight = 0;
+
+			void* m_sq_ring = nullptr;
+			size_t m_sq_ring_size = 0;
+			unsigned* m_sq_head = nullptr;
+			unsigned* m_sq_tail = nullptr;
+			unsigned* m_sq_mask = nullptr;
+			unsigned* m_sq_array = nullptr;
+			unsigned m_sq_entries = 0;
+			io_uring_sqe* m_sqes = nullptr;
+			size_t m_sqes_size = 0;
+
+			void* m_cq_ring = nullptr;
+			size_t m_cq_ring_size = 0;
+			unsigned* m_cq_head = nullptr;
+			unsigned* m_cq_tail = nullptr;
+			unsigned* m_cq_mask = nullptr;
+			io_uring_cqe* m_cqes = nullptr;
+		};
+
+		/* File, io_uring and set of buffers shared by io_uring_reader and io_uring_writer
+		Each buffer is used by one request at a time: the request for buffer i has user_data i
+		Buffers are used in a round robin manner, from m_first (the oldest request) to m_first + m_in_use */
+		class io_uring_file
+		{
+		protected:
+			io_uring_file(const char* path, int flags, unsigned queue_depth, size_t chunk_size)
+				: m_file(path, flags)
+				, m_queue(queue_depth)
+				, m_chunk_size(chunk_size)
+			{
+				assert(queue_depth > 0 && chunk_size > 0);
+				std::vector<iovec> iovecs;
+				for (unsigned i = 0; i < queue_depth; ++i)
+				{
+					m_slots.push_back({ aligned_buffer(chunk_size) });
+					iovecs.push_back({ m_slots.back().buffer.data(), chunk_size });
+				}
+
+				// Registered buffers save the kernel from mapping the pages on every request
+				// Registration can fail (for example if the process is limited in how much memory it can lock), in which case regular requests are used
+				m_fixed_buffers = syscall(__NR_io_uring_register, m_queue.fd(), IORING_REGISTER_BUFFERS, iovecs.data(), queue_depth) == 0;
+			}
+			~io_uring_file()
+			{
+				// The kernel might still be using the buffers, wait for all the requests to complete before freeing them
+				try
+				{
+					for (auto& slot : m_slots)
+					{
+						while (slot.pending)
+							complete(m_queue.wait());
+					}
+				}
+				catch (...)
+				{
+				}
+			}
+			io_uring_file(const io_uring_file&) = delete;
+			io_uring_file& operator = (const io_uring_file&) = delete;
+
+			struct slot
+			{
+				aligned_buffer buffer;
+				uint64_t offset = 0;
+				size_t cb_done = 0;       // number of bytes already read or written in previous requests for that slot
+				size_t cb_requested = 0;  // total size of the read or write (including cb_done)
+				int result = 0;
+				bool pending = false;
+			};
+
+			void send(size_t index, bool write)
+			{
+				auto& s = m_slots[index];
+				io_uring_sqe sqe;
+				memset(&sqe, 0, sizeof(sqe));
+				sqe.fd = m_file.get();
+				sqe.off = s.offset + s.cb_done;
+				sqe.addr = reinterpret_cast<uint64_t>(s.buffer.data() + s.cb_done);
+				// Requests of 4GB or more are split: the rest is sent again like after a short read or write
+				sqe.len = static_cast<uint32_t>(std::min<size_t>(s.cb_requested - s.cb_done, std::numeric_limits<uint32_t>::max()));
+				sqe.user_data = index;
+				if (m_fixed_buffers)
+				{
+					sqe.opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+					sqe.buf_index = static_cast<uint16_t>(index);
+				}
+				else
+				{
+					sqe.opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+				}
+				s.pending = true;
+				m_queue.push(sqe);
+			}
+			void complete(const io_uring_cqe& cqe)
+			{
+				auto& s = m_slots[static_cast<size_t>(cqe.user_data)];
+				s.result = cqe.res;
+				s.pending = false;
+			}
+			void wait_for(size_t index)
+			{
+				m_queue.submit();
+				while (m_slots[index].pending)
+					complete(m_queue.wait());
+			}
+			size_t slot_index(size_t i) const { return (m_first + i) % m_slots.size(); }
+
+			fd_handle m_file;
+			io_uring_queue m_queue;
+			size_t m_chunk_size;
+			bool m_fixed_buffers;
+			std::vector<slot> m_slots;
+			size_t m_first = 0;
+			size_t m_in_use = 0;
+			uint64_t m_next_offset = 0;
+		};
+
+		// Reads kept in flight by io_uring_reader
+		class io_uring_reader_state : public io_uring_file
+		{
+		public:
+			io_uring_reader_state(const char* path, unsigned queue_depth, size_t chunk_size)
+				: io_uring_file(path, O_RDONLY, queue_depth, chunk_size)
+			{}
+
+			const_buffer_ref read_view(size_t max)
+			{
+				if (max == 0)
+					return{};
+				while (m_remaining.empty())
+				{
+					if (!next_chunk())
+						return{};
+				}
+				return m_remaining.slice_from_front(std::min(max, m_remaining.size()));
+			}
+			void consume(size_t cb)
+			{
+				m_remaining.remove_front(cb);
+			}
+
+		private:
+			void send_reads()
+			{
+				while (!m_end_of_file && m_in_use < m_slots.size())
+				{
+					auto index = slot_index(m_in_use++);
+					auto& s = m_slots[index];
+					s.offset = m_next_offset;
+					s.cb_done = 0;
+					s.cb_requested = m_chunk_size;
+					m_next_offset += m_chunk_size;
+					send(index, false /*write*/);
+				}
+				m_queue.submit();
+			}
+			bool next_chunk()
+			{
+				if (m_has_current)
+				{
+					// Done with the oldest chunk, its buffer can be reused
+					m_first = slot_index(1);
+					--m_in_use;
+					m_has_current = false;
+				}
+				send_reads();
+				if (m_in_use == 0)
+					return false;
+
+				auto& s = m_slots[m_first];
+				for (;;)
+				{
+					wait_for(m_first);
+					if (s.result == -EINTR || s.result == -EAGAIN)
+					{
+						send(m_first, false /*write*/);
+						continue;
+					}
+					if (s.result < 0)
+						throw io_exception_with_error_code{ "Error during file read", -s.result };
+					break;
+				}
+
+				auto cb_read = static_cast<size_t>(s.result);
+				if (cb_read < s.cb_requested)
+				{
+					// Either the end of the file, or a short read: the reads sent after this one were for the wrong offsets
+					for (size_t i = 1; i < m_in_use; ++i)
+						wait_for(slot_index(i));
+					m_in_use = 1;
+					m_next_offset = s.offset + cb_read;
+					m_end_of_file = (cb_read == 0);
+				}
+
+				m_has_current = true;
+				m_remaining = { s.buffer.data(), cb_read };
+				send_reads();
+				return true;
+			}
+
+			const_buffer_ref m_remaining;
+			bool m_has_current = false;
+			bool m_end_of_file = false;
+		};
+
+		// Writes kept in flight by io_uring_writer (the data not yet flushed is written on destruction)
+		class io_uring_writer_state : public io_uring_file
+		{
+		public:
+			io_uring_writer_state(const char* path, unsigned queue_depth, size_t chunk_size)
+				: io_uring_file(path, O_WRONLY | O_CREAT | O_TRUNC, queue_depth, chunk_size)
+			{}
+			~io_uring_writer_state()
+			{
+				try
+				{
+					flush();
+				}
+				catch (...)
+				{
+				}
+			}
+
+			void write_buffer(const_buffer_ref data)
+			{
+				while (!data.empty())
+				{
+					if (!m_has_current)
+						start_chunk();
+
+					auto& s = m_slots[slot_index(m_in_use - 1)];
+					auto cb = std::min(m_chunk_size - s.cb_requested, data.size());
+					copy(data.remove_front(cb), buffer_ref{ s.buffer.data() + s.cb_requested, cb });
+					s.cb_requested += cb;
+					if (s.cb_requested == m_chunk_size)
+						send_current();
+				}
+			}
+			void flush()
+			{
+				if (m_has_current)
+					send_current();
+				while (m_in_use > 0)
+					retire_oldest();
+			}
+
+		private:
+			void start_chunk()
+			{
+				if (m_in_use == m_slots.size())
+					retire_oldest();
+
+				auto& s = m_slots[slot_index(m_in_use++)];
+				s.offset = m_next_offset;
+				s.cb_done = 0;
+				s.cb_requested = 0;
+				m_has_current = true;
+			}
+			void send_current()
+			{
+				auto index = slot_index(m_in_use - 1);
+				m_next_offset += m_slots[index].cb_requested;
+				m_has_current = false;
+				send(index, true /*write*/);
+				m_queue.submit();
+			}
+			void retire_oldest()
+			{
+				auto& s = m_slots[m_first];
+				for (;;)
+				{
+					wait_for(m_first);
+					if (s.result == -EINTR || s.result == -EAGAIN)
+					{
+						send(m_first, true /*write*/);
+						continue;
+					}
+					if (s.result < 0)
+					{
+						m_first = slot_index(1);
+						--m_in_use;
+						throw io_exception_with_error_code{ "Error during file write", -s.result };
+					}
+
+					// Short write: send the rest of the chunk
+					s.cb_done += static_cast<size_t>(s.result);
+					if (s.cb_done == s.cb_requested)
+						break;
+					send(m_first, true /*write*/);
+				}
+				m_first = slot_index(1);
+				--m_in_use;
+			}
+
+			bool m_has_current = false;
+		};
+	}
+
+	/* Reader on a file using io_uring: up to queue_depth reads of chunk_size bytes are kept in flight ahead of the consumer
+	Only works on files that support reading at an offset (regular files, block devices)
+	The io_uring and the buffers the kernel reads into are allocated once, so that moving the reader doesn't move them */
+	class io_uring_reader
+	{
+	public:
+		io_uring_reader(const char* path, unsigned queue_depth = default_io_uring_queue_depth, size_t chunk_size = default_io_uring_chunk_size)
+			: m_state(std::make_unique<details::io_uring_reader_state>(path, queue_depth, chunk_size))
+		{}
+		io_uring_reader(const std::string& path, unsigned queue_depth = default_io_uring_queue_depth, size_t chunk_size = default_io_uring_chunk_size)
+			: io_uring_reader(path.c_str(), queue_depth, chunk_size)
+		{}
+		io_uring_reader(io_uring_reader&&) = default;
+		io_uring_reader(const io_uring_reader&) = delete;
+		io_uring_reader& operator = (const io_uring_reader&) = delete;
+		io_uring_reader& operator = (io_uring_reader&&) = delete;
+
+		size_t read_partial_buffer(buffer_ref data)
+		{
+			auto view = m_state->read_view(data.size());
+			copy(view, buffer_ref{ data.data(), view.size() });
+			m_state->consume(view.size());
+			return view.size();
+		}
+		const_buffer_ref read_view(size_t max) { return m_state->read_view(max); }
+		void consume(size_t cb) { m_state->consume(cb); }
+
+	private:
+		std::unique_ptr<details::io_uring_reader_state> m_state;
+	};
+
+	/* Writer on a file using io_uring: data is accumulated in chunks of chunk_size bytes, up to queue_depth chunks are written concurrently
+	Write errors are reported by the following call to write_buffer or flush
+	Data not yet flushed is written on destruction, ignoring errors (call flush to get those errors) */
+	class io_uring_writer
+	{
+	public:
+		io_uring_writer(const char* path, unsigned queue_depth = default_io_uring_queue_depth, size_t chunk_size = default_io_uring_chunk_size)
+			: m_state(std::make_unique<details::io_uring_writer_state>(path, queue_depth, chunk_size))
+		{}
+		io_uring_writer(const std::string& path, unsigned queue_depth = default_io_uring_queue_depth, size_t chunk_size = default_io_uring_chunk_size)
+			: io_uring_writer(path.c_str(), queue_depth, chunk_size)
+		{}
+		io_uring_writer(io_uring_writer&&) = default;
+		io_uring_writer(const io_uring_writer&) = delete;
+		io_uring_writer& operator = (const io_uring_writer&) = delete;
+		io_uring_writer& operator = (io_uring_writer&&) = delete;
+
+		void write_buffer(const_buffer_ref data) { m_state->write_buffer(data); }
+		void flush() { m_state->flush(); }
+
+	private:
+		std::unique_ptr<details::io_uring_writer_state> m_state;
+	};
+}}
+
+#endif
\ No newline at end of file
@@ -2,37 +2,70 @@
 
 #include "base64_stream.h"
 #include "debug_checks_reader.h"
+#include "floating_point.h"
 #include "tags.h"
 #include "variant.h"
 #include "stream.h"
 #include "optional.h"
 #include "sax_reader.h"
 
+#include <cstring>
+#include <vector>
+
 namespace goldfish { namespace json
 {
 	struct ill_formatted_json_data : ill_formatted { using ill_formatted::ill_formatted; };
 	struct integer_overflow_in_json : ill_formatted_json_data { using ill_formatted_json_data::ill_formatted_json_data; };
 
 	class byte_string;
+	class raw_number;
 	template <class Stream> class text_string;
-	template <class Stream> class array;
-	template <class Stream> class map;
-	template <class Stream> struct document : document_impl<
-		true /*does_json_conversions*/,
-		bool,
-		nullptr_t,
-		uint64_t,
-		int64_t,
-		double,
-		undefined,
-		text_string<Stream>,
-		byte_string,
-		array<Stream>,
-		map<Stream>>
+	template <class Stream, bool raw_numbers = false> class array;
+	template <class Stream, bool raw_numbers = false> class map;
+
+	namespace details
 	{
-		using document_impl::document_impl;
+		template <class Stream, bool raw_numbers> struct document_base
+		{
+			using type = document_impl<
+				true /*does_json_conversions*/,
+				bool,
+				nullptr_t,
+				uint64_t,
+				int64_t,
+				double,
+				undefined,
+				text_string<Stream>,
+				byte_string,
+				array<Stream>,
+				map<Stream>>;
+		};
+		template <class Stream> struct document_base<Stream, true /*raw_numbers*/>
+		{
+			using type = document_impl<
+				true /*does_json_conversions*/,
+				bool,
+				nullptr_t,
+				raw_number,
+				undefined,
+				text_string<Stream>,
+				byte_string,
+				array<Stream, true>,
+				map<Stream, true>>;
+		};
+	}
+
+	// If raw_numbers is true, numbers are kept as text (see read_raw_numbers)
+	template <class Stream, bool raw_numbers = false> struct document : details::document_base<Stream, raw_numbers>::type
+	{
+		using base = typename details::document_base<Stream, raw_numbers>::type;
+		using base::base;
 	};
-	template <class Stream> document<std::decay_t<Stream>> read_no_debug_check(Stream&& s);
+
+	namespace details
+	{
+		template <bool raw_numbers, class Stream> document<std::decay_t<Stream>, raw_numbers> read_no_debug_check(Stream&& s);
+	}
 
 	namespace details
 	{
@@ -64,6 +97,202 @@ namespace goldfish { namespace json
 					throw ill_formatted_json_data{ "Unexpected JSON document value" };
 			}
 		}
+
+		#if defined(GOLDFISH_AVX2) || defined(GOLDFISH_SSE4_1)
+		// Set the bytes that need special handling in a JSON string: '"', '\\', control characters and bytes that can't appear in UTF8 (0xF8 and above)
+		inline __m128i special_string_characters(__m128i input)
+		{
+			auto quote = _mm_cmpeq_epi8(input, _mm_set1_epi8('"'));
+			auto backslash = _mm_cmpeq_epi8(input, _mm_set1_epi8('\\'));
+			auto control = _mm_cmpeq_epi8(_mm_max_epu8(input, _mm_set1_epi8(0x1F)), _mm_set1_epi8(0x1F));
+			auto invalid = _mm_cmpeq_epi8(_mm_min_epu8(input, _mm_set1_epi8(static_cast<char>(0xF8))), _mm_set1_epi8(static_cast<char>(0xF8)));
+			return _mm_or_si128(_mm_or_si128(quote, backslash), _mm_or_si128(control, invalid));
+		}
+		#endif
+		#ifdef GOLDFISH_AVX2
+		inline __m256i special_string_characters(__m256i input)
+		{
+			auto quote = _mm256_cmpeq_epi8(input, _mm256_set1_epi8('"'));
+			auto backslash = _mm256_cmpeq_epi8(input, _mm256_set1_epi8('\\'));
+			auto control = _mm256_cmpeq_epi8(_mm256_max_epu8(input, _mm256_set1_epi8(0x1F)), _mm256_set1_epi8(0x1F));
+			auto invalid = _mm256_cmpeq_epi8(_mm256_min_epu8(input, _mm256_set1_epi8(static_cast<char>(0xF8))), _mm256_set1_epi8(static_cast<char>(0xF8)));
+			return _mm256_or_si256(_mm256_or_si256(quote, backslash), _mm256_or_si256(control, invalid));
+		}
+		#endif
+
+		// Skip the characters of a JSON string that don't need special handling, 32 or 16 bytes at a time
+		// Returns the first character that needs special handling, or the beginning of the last (incomplete) block, which is left to the caller
+		inline const byte* skip_simple_string_characters(const byte* it, const byte* end)
+		{
+			#ifdef GOLDFISH_AVX2
+			for (; end - it >= 32; it += 32)
+			{
+				auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(special_string_characters(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(it)))));
+				if (mask != 0)
+					return it + count_trailing_zeros(mask);
+			}
+			#endif
+			#if defined(GOLDFISH_AVX2) || defined(GOLDFISH_SSE4_1)
+			for (; end - it >= 16; it += 16)
+			{
+				auto mask = static_cast<uint32_t>(_mm_movemask_epi8(special_string_characters(_mm_loadu_si128(reinterpret_cast<const __m128i*>(it)))));
+				if (mask != 0)
+					return it + count_trailing_zeros(mask);
+			}
+			#else
+			(void)end;
+			#endif
+			return it;
+		}
+
+		#if defined(GOLDFISH_AVX2) || defined(GOLDFISH_SSE4_1)
+		// Set the bytes that matter to find the end of a JSON value: '"', '\\' and brackets
+		// ('[' and ']' are '{' and '}' with bit 5 cleared, and no other character gives '{' or '}' once bit 5 is set)
+		inline __m128i value_delimiters(__m128i input)
+		{
+			auto quote_or_backslash = _mm_or_si128(_mm_cmpeq_epi8(input, _mm_set1_epi8('"')), _mm_cmpeq_epi8(input, _mm_set1_epi8('\\')));
+			auto bracket = _mm_or_si128(input, _mm_set1_epi8(0x20));
+			return _mm_or_si128(quote_or_backslash, _mm_or_si128(_mm_cmpeq_epi8(bracket, _mm_set1_epi8('{')), _mm_cmpeq_epi8(bracket, _mm_set1_epi8('}'))));
+		}
+		#endif
+		#ifdef GOLDFISH_AVX2
+		inline __m256i value_delimiters(__m256i input)
+		{
+			auto quote_or_backslash = _mm256_or_si256(_mm256_cmpeq_epi8(input, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(input, _mm256_set1_epi8('\\')));
+			auto bracket = _mm256_or_si256(input, _mm256_set1_epi8(0x20));
+			return _mm256_or_si256(quote_or_backslash, _mm256_or_si256(_mm256_cmpeq_epi8(bracket, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(bracket, _mm256_set1_epi8('}'))));
+		}
+		#endif
+		#if defined(GOLDFISH_AVX2) || defined(GOLDFISH_SSE4_1)
+		// Mask of the value delimiters in 32 bytes of input (bit i describes byte i)
+		inline uint32_t find_value_delimiters(const byte* input)
+		{
+			#ifdef GOLDFISH_AVX2
+			return static_cast<uint32_t>(_mm256_movemask_epi8(value_delimiters(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input)))));
+			#else
+			auto low = static_cast<uint32_t>(_mm_movemask_epi8(value_delimiters(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input)))));
+			auto high = static_cast<uint32_t>(_mm_movemask_epi8(value_delimiters(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 16)))));
+			return low | (high << 16);
+			#endif
+		}
+		#endif
+
+		/*
+		Finds the end of a JSON value without parsing it, to skip strings, arrays and maps that the application doesn't read
+		Only the depth of the brackets, whether the current character is in a string and whether it is escaped are tracked:
+		the content of the value is not validated
+		The skipper starts in a string or a container that was already opened, and ends after the quote or the bracket that closes it
+		*/
+		class value_skipper
+		{
+		public:
+			value_skipper(uint32_t depth, bool in_string)
+				: m_depth(depth)
+				, m_in_string(in_string)
+			{}
+
+			// Returns the position after the end of the value, or nullptr if the value doesn't end before end (the state is then kept for the next call)
+			const byte* find_end(const byte* it, const byte* end)
+			{
+				auto depth = m_depth;
+				auto in_string = m_in_string;
+				auto escaped = m_escaped;
+
+				#if defined(GOLDFISH_AVX2) || defined(GOLDFISH_SSE4_1)
+				// Only the delimiters of each block of 32 bytes are looked at, which are rare in the content of strings
+				for (; end - it >= 32; it += 32)
+				{
+					auto mask = find_value_delimiters(it);
+					if (escaped)
+					{
+						mask &= ~1u;
+						escaped = false;
+					}
+					while (mask != 0)
+					{
+						auto i = count_trailing_zeros(mask);
+						mask &= mask - 1;
+						if (it[i] == '\\')
+						{
+							if (in_string)
+							{
+								mask &= ~(2u << i); // the escaped character is not a delimiter
+								escaped = (i == 31);
+							}
+						}
+						else if (ends_value(it[i], depth, in_string))
+						{
+							return it + i + 1;
+						}
+					}
+				}
+				#endif
+				for (; it != end; ++it)
+				{
+					if (escaped)
+						escaped = false;
+					else if (*it == '\\')
+						escaped = in_string;
+					else if (ends_value(*it, depth, in_string))
+						return it + 1;
+				}
+
+				m_depth = depth;
+				m_in_string = in_string;
+				m_escaped = escaped;
+				return nullptr;
+			}
+
+		private:
+			// Update the state after a character that isn't escaped, returns true if that character ends the value
+			static bool ends_value(byte c, uint32_t& depth, bool& in_string)
+			{
+				if (c == '"')
+				{
+					in_string = !in_string;
+					return !in_string && depth == 0;
+				}
+				if (in_string)
+					return false;
+				if (c == '[' || c == '{')
+					++depth;
+				else if (c == ']' || c == '}')
+					return --depth == 0;
+				return false;
+			}
+
+			uint32_t m_depth;
+			bool m_in_string;
+			bool m_escaped = false;
+		};
+
+		template <class Stream> void skip_to_end_of_value(Stream& s, value_skipper skipper, std::false_type /*has_read_view*/)
+		{
+			const byte* end;
+			do
+			{
+				auto c = stream::read<byte>(s);
+				end = skipper.find_end(&c, &c + 1);
+			} while (end == nullptr);
+		}
+		template <class Stream> void skip_to_end_of_value(Stream& s, value_skipper skipper, std::true_type /*has_read_view*/)
+		{
+			// Scan the data in place, one view at a time
+			for (;;)
+			{
+				auto view = s.read_view(std::numeric_limits<size_t>::max());
+				if (view.empty())
+					throw stream::unexpected_end_of_stream();
+
+				if (auto end = skipper.find_end(view.begin(), view.end()))
+				{
+					s.consume(end - view.begin());
+					return;
+				}
+				s.consume(view.size());
+			}
+		}
+		template <class Stream> void skip_to_end_of_value(Stream& s, value_skipper skipper) { skip_to_end_of_value(s, skipper, stream::has_read_view<Stream>()); }
 	}
 
 	class byte_string
@@ -95,47 +324,13 @@ namespace goldfish { namespace json
 
 			copy_from_converted(buffer);
 
-			enum category : uint8_t
-			{
-				S, // simple (just needs to be forwarded to the inner stream)
-				E, // escape: \ character
-				Q, // quote: " character
-				I, // character should have been escaped or is not a valid UTF8 character
-			};
-			static const category lookup[] = {
-				/*       0 1 2 3 4 5 6 7 8 9 A B C D E F */
-				/*0x00*/ I,I,I,I,I,I,I,I,I,I,I,I,I,I,I,I,
-				/*0x10*/ I,I,I,I,I,I,I,I,I,I,I,I,I,I,I,I,
-				/*0x20*/ S,S,Q,S,S,S,S,S,S,S,S,S,S,S,S,S,
-				/*0x30*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
-				/*0x40*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
-				/*0x50*/ S,S,S,S,S,S,S,S,S,S,S,S,E,S,S,S,
-				/*0x60*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
-				/*0x70*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
-				/*0x80*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
-				/*0x90*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
-				/*0xA0*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
-				/*0xB0*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
-				/*0xC0*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
-				/*0xD0*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
-				/*0xE0*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
-				/*0xF0*/ S,S,S,S,S,S,S,S,I,I,I,I,I,I,I,I,
-			};
-			static_assert(sizeof(lookup) / sizeof(lookup[0]) == 256, "The lookup table should have 256 entries");
-
 			while (!buffer.empty())
 			{
 				byte c;
-				auto it = buffer.begin();
-				while (lookup[c = stream::read<byte>(m_stream)] == S)
-				{
-					*(it++) = c;
-					if (it == buffer.end())
-						return original;
-				}
-				buffer.remove_front(it - buffer.begin());
+				if (!copy_simple_characters(buffer, c, stream::has_read_view<Stream>()))
+					return original;
 
-				switch (lookup[c])
+				switch (get_category(c))
 				{
 				case E:
 					switch (stream::read<byte>(m_stream))
@@ -171,7 +366,86 @@ namespace goldfish { namespace json
 			return original - buffer.size();
 		}
 
+		// Skip the rest of the string without decoding it (the characters skipped are not validated)
+		void seek_to_end()
+		{
+			if (m_converted.front() == end_of_stream)
+				return;
+
+			details::skip_to_end_of_value(m_stream, details::value_skipper(0 /*depth*/, true /*in_string*/));
+			m_converted = { end_of_stream, invalid_char, invalid_char };
+		}
+
 	private:
+		enum category : uint8_t
+		{
+			S, // simple (just needs to be forwarded to the inner stream)
+			E, // escape: \ character
+			Q, // quote: " character
+			I, // character should have been escaped or is not a valid UTF8 character
+		};
+		static category get_category(byte c)
+		{
+			static const category lookup[] = {
+				/*       0 1 2 3 4 5 6 7 8 9 A B C D E F */
+				/*0x00*/ I,I,I,I,I,I,I,I,I,I,I,I,I,I,I,I,
+				/*0x10*/ I,I,I,I,I,I,I,I,I,I,I,I,I,I,I,I,
+				/*0x20*/ S,S,Q,S,S,S,S,S,S,S,S,S,S,S,S,S,
+				/*0x30*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
+				/*0x40*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
+				/*0x50*/ S,S,S,S,S,S,S,S,S,S,S,S,E,S,S,S,
+				/*0x60*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
+				/*0x70*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
+				/*0x80*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
+				/*0x90*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
+				/*0xA0*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
+				/*0xB0*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
+				/*0xC0*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
+				/*0xD0*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
+				/*0xE0*/ S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,S,
+				/*0xF0*/ S,S,S,S,S,S,S,S,I,I,I,I,I,I,I,I,
+			};
+			static_assert(sizeof(lookup) / sizeof(lookup[0]) == 256, "The lookup table should have 256 entries");
+			return lookup[c];
+		}
+
+		// Copy the characters that don't need any conversion to the buffer
+		// Returns false if the buffer got filled, or true if a character that needs special handling was found (that character is read and returned in c)
+		bool copy_simple_characters(buffer_ref& buffer, byte& c, std::false_type /*has_read_view*/)
+		{
+			auto it = buffer.begin();
+			while (get_category(c = stream::read<byte>(m_stream)) == S)
+			{
+				*(it++) = c;
+				if (it == buffer.end())
+					return false;
+			}
+			buffer.remove_front(it - buffer.begin());
+			return true;
+		}
+		bool copy_simple_characters(buffer_ref& buffer, byte& c, std::true_type /*has_read_view*/)
+		{
+			// The inner stream has the data in memory: find the end of the run of simple characters and copy it in one go
+			while (!buffer.empty())
+			{
+				auto view = m_stream.read_view(buffer.size());
+				if (view.empty())
+					throw stream::unexpected_end_of_stream();
+
+				auto it = std::find_if(details::skip_simple_string_characters(view.begin(), view.end()), view.end(), [](byte x) { return get_category(x) != S; });
+				auto cb = static_cast<size_t>(it - view.begin());
+				copy(view.slice_from_front(cb), buffer.remove_front(cb));
+				if (it != view.end())
+				{
+					c = *it;
+					m_stream.consume(cb + 1);
+					return true;
+				}
+				m_stream.consume(cb);
+			}
+			return false;
+		}
+
 		static const byte invalid_char = 0xFF;
 		static const byte end_of_stream = 0xFE;
 		void copy_from_converted(buffer_ref& buffer)
@@ -257,13 +531,13 @@ namespace goldfish { namespace json
 		uint8_t padding_for_variant;
 	};
 
-	template <class Stream, char end_character> class comma_separated_reader
+	template <class Stream, char end_character, bool raw_numbers> class comma_separated_reader
 	{
 	public:
 		comma_separated_reader(Stream&& s)
 			: m_stream(std::move(s))
 		{}
-		optional<document<stream::reader_ref_type_t<Stream>>> read_comma_separated()
+		optional<document<stream::reader_ref_type_t<Stream>, raw_numbers>> read_comma_separated()
 		{
 			switch (m_state)
 			{
@@ -282,7 +556,7 @@ namespace goldfish { namespace json
 					else
 					{
 						m_state = state::middle;
-						return read_no_debug_check(stream::ref(m_stream));
+						return details::read_no_debug_check<raw_numbers>(stream::ref(m_stream));
 					}
 				}
 
@@ -290,7 +564,7 @@ namespace goldfish { namespace json
 				{
 					switch (details::read_non_space(m_stream))
 					{
-					case ',': return read_no_debug_check(stream::ref(m_stream));
+					case ',': return details::read_no_debug_check<raw_numbers>(stream::ref(m_stream));
 					case end_character: m_state = state::ended; return nullopt;
 					default: throw ill_formatted_json_data{ "Invalid delimiter in JSON array or map" };
 					}
@@ -302,6 +576,15 @@ namespace goldfish { namespace json
 				default: std::terminate();
 			}
 		}
+		// Skip the rest of the array or map without parsing its elements (the data skipped is not validated, only the brackets are counted)
+		void seek_to_end()
+		{
+			if (m_state == state::ended)
+				return;
+
+			details::skip_to_end_of_value(m_stream, details::value_skipper(1 /*depth*/, false /*in_string*/));
+			m_state = state::ended;
+		}
 
 		Stream m_stream;
 		enum class state : uint8_t
@@ -315,18 +598,18 @@ namespace goldfish { namespace json
 		// This helps lower the size of a variant that contains an array or a map by allowing variant to store the type in the padding rather than appending a new field
 		uint8_t padding_for_variant;
 	};
-	template <class Stream> class array : public comma_separated_reader<Stream, ']'>
+	template <class Stream, bool raw_numbers> class array : public comma_separated_reader<Stream, ']', raw_numbers>
 	{
 	public:
 		using tag = tags::array;
-		using comma_separated_reader<Stream, ']'>::comma_separated_reader;
+		using comma_separated_reader<Stream, ']', raw_numbers>::comma_separated_reader;
 		auto read() { return read_comma_separated(); }
 	};
-	template <class Stream> class map : public comma_separated_reader<Stream, '}'>
+	template <class Stream, bool raw_numbers> class map : public comma_separated_reader<Stream, '}', raw_numbers>
 	{
 	public:
 		using tag = tags::map;
-		using comma_separated_reader<Stream, '}'>::comma_separated_reader;
+		using comma_separated_reader<Stream, '}', raw_numbers>::comma_separated_reader;
 
 		auto read_key()
 		{
@@ -335,136 +618,482 @@ namespace goldfish { namespace json
 				throw ill_formatted_json_data{ "Only strings are supported for JSON keys" };
 			return key;
 		}
-		document<stream::reader_ref_type_t<Stream>> read_value()
+		document<stream::reader_ref_type_t<Stream>, raw_numbers> read_value()
 		{
 			if (details::read_non_space(m_stream) != ':')
 				throw ill_formatted_json_data{ "':' expected between JSON key and value" };
-			return read_no_debug_check(stream::ref(m_stream));
+			return details::read_no_debug_check<raw_numbers>(stream::ref(m_stream));
 		}
 	};
 
-	template <class Stream> uint64_t read_unsigned_integer(Stream& s, char first, bool allow_leading_zeroes)
+	namespace details
 	{
-		if (allow_leading_zeroes)
+		// Up to 8 digits read at once, see floating_point::decimal::add_digits
+		struct digits
 		{
-			if (first < '0' || first > '9')
-				throw ill_formatted_json_data{ "Invalid digit in JSON integer" };
-		}
-		else
-		{
-			if (first == '0')
-				return 0u;
+			uint64_t characters;
+			unsigned count;
+		};
 
-			if (first < '1' || first > '9')
-				throw ill_formatted_json_data{ "Invalid digit in JSON integer" };
+		// Read up to 8 digits at once (SWAR) when the stream has the next 8 characters in memory
+		// Returns nullopt (without reading anything) otherwise, the digits then have to be read one at a time
+		template <class Stream> optional<digits> read_up_to_eight_digits(Stream&, std::false_type /*has_read_view*/) { return nullopt; }
+		template <class Stream> optional<digits> read_up_to_eight_digits(Stream& s, std::true_type /*has_read_view*/)
+		{
+			auto view = s.read_view(8);
+			if (view.size() < 8)
+				return nullopt;
+			auto characters = floating_point::details::load_eight_characters(reinterpret_cast<const char*>(view.data()));
+			auto count = floating_point::details::count_leading_digits(characters);
+			s.consume(count);
+			return digits{ characters, count };
 		}
+		template <class Stream> optional<digits> read_up_to_eight_digits(Stream& s) { return read_up_to_eight_digits(s, stream::has_read_view<Stream>()); }
 
-		uint64_t result = (first - '0');
-		for (;;)
-		{
-			auto c = s.peek<char>();
-			if (c == nullopt || *c < '0' || *c > '9')
-				return result;
+		inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
 
-			if (result > (std::numeric_limits<uint64_t>::max() - (*c - '0')) / 10)
-				throw integer_overflow_in_json{ "JSON integer too large" };
-			result = (result * 10) + *c - '0';
-			stream::read<char>(s);
+		// Passes the digits that follow to the handler, 8 at a time while the input allows it, then one by one
+		template <class Input, class Handler, class IsFraction> void parse_digits(Input& in, Handler& h, IsFraction is_fraction)
+		{
+			while (auto digits = in.read_up_to_eight_digits())
+			{
+				h.add_digits(digits->characters, digits->count, is_fraction);
+				if (digits->count < 8)
+					break;
+			}
+			for (auto c = in.peek(); is_digit(c); c = in.peek())
+			{
+				h.add_digit(c, is_fraction);
+				in.skip();
+			}
 		}
-	}
-	template <class Stream> double read_decimals(Stream& s)
-	{
-		auto first = s.peek<char>();
-		if (first == nullopt || *first < '0' || *first > '9')
-			throw ill_formatted_json_data{ "Invalid digit in JSON integer" };
-
-		double result = 0;
-		double divider = 1;
-		for (;;)
+		/*
+		The JSON number grammar, shared by read_number, read_raw_number and the numbers parsed in place (see parse_number_in_place)
+		The characters come from Input:
+		- read() consumes the next character, peek() returns it without consuming it ('\0' after the last one) and skip() consumes it
+		- read_up_to_eight_digits() consumes the next digits, up to 8 at once, or returns nullopt if it can't
+		- invalid() reports a syntax error
+		and are passed to Handler, which builds the result
+		first is the '-' or the first digit, already read
+		Returns false if Input::invalid does rather than throwing
+		*/
+		template <class Input, class Handler> bool parse_number(Input& in, char first, Handler& h)
 		{
-			auto c = s.peek<char>();
-			if (c == nullopt || *c < '0' || *c > '9')
-				return result;
+			if (first == '-')
+			{
+				h.negative();
+				first = in.read();
+			}
+
+			// Leading zeroes are not allowed: 0 can only be followed by a decimal point or an exponent
+			if (!is_digit(first))
+				return in.invalid();
+			h.add_digit(first, std::false_type /*is_fraction*/());
+			if (first != '0')
+				parse_digits(in, h, std::false_type /*is_fraction*/());
+
+			auto floating_point_marker = in.peek();
+			if (floating_point_marker == '.')
+			{
+				in.skip();
+				h.decimal_point();
+				if (!is_digit(in.peek()))
+					return in.invalid();
+				parse_digits(in, h, std::true_type /*is_fraction*/());
+				floating_point_marker = in.peek();
+			}
 
-			divider *= 10;
-			result += (*c - '0') / divider;
-			stream::read<char>(s);
+			if (floating_point_marker == 'e' || floating_point_marker == 'E')
+			{
+				in.skip();
+				h.exponent(floating_point_marker);
+				first = in.read();
+				if (first == '+' || first == '-')
+				{
+					h.exponent_sign(first);
+					first = in.read();
+				}
+				if (!is_digit(first))
+					return in.invalid();
+				h.add_exponent_digit(first);
+				for (auto c = in.peek(); is_digit(c); c = in.peek())
+				{
+					h.add_exponent_digit(c);
+					in.skip();
+				}
+			}
+			return true;
 		}
-	}
-	template <class Stream> variant<uint64_t, int64_t, double> read_number(Stream& s, char first)
-	{
-		bool negative = false;
-		if (first == '-')
+
+		// Input of parse_number that reads from a stream
+		template <class Stream> class number_from_stream
 		{
-			negative = true;
-			first = stream::read<char>(s);
-		}
+		public:
+			number_from_stream(Stream& s)
+				: m_stream(s)
+			{}
+			char read() { return stream::read<char>(m_stream); }
+			char peek()
+			{
+				auto c = m_stream.peek<char>();
+				return c == nullopt ? '\0' : *c;
+			}
+			void skip() { stream::read<char>(m_stream); }
+			optional<digits> read_up_to_eight_digits() { return details::read_up_to_eight_digits(m_stream); }
+			bool invalid() { throw ill_formatted_json_data{ "Invalid digit in JSON integer" }; }
 
-		auto integer = read_unsigned_integer(s, first, false /*allow_leading_zeroes*/);
+		private:
+			Stream& m_stream;
+		};
 
-		auto floating_point_marker = s.peek<char>();
-		if (floating_point_marker != '.' && floating_point_marker != 'e' && floating_point_marker != 'E')
+		// Handler of parse_number that computes the value of the number
+		// Integers of up to 19 digits always fit in 64 bits: they are the most common numbers and are parsed without a floating_point::decimal
+		class number_value
 		{
-			if (negative)
+		public:
+			void negative() { m_negative = true; }
+			void add_digit(char c, std::false_type /*is_fraction*/)
+			{
+				if (!m_has_decimal && m_integer_part < 1000000000000000000ull)
+					m_integer_part = m_integer_part * 10 + static_cast<uint64_t>(c - '0');
+				else
+					to_decimal().add_digit(c);
+			}
+			void add_digit(char c, std::true_type /*is_fraction*/) { to_decimal().add_fraction_digit(c); }
+			void add_digits(uint64_t characters, unsigned count, std::false_type /*is_fraction*/)
 			{
+				static const uint32_t powers_of_ten[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+				if (count == 0)
+					return;
+				if (!m_has_decimal && m_integer_part < 100000000000ull) // 11 digits followed by 8 more always fit
+					m_integer_part = m_integer_part * powers_of_ten[count] + floating_point::details::parse_digits(characters, count);
+				else
+					to_decimal().add_digits(characters, count);
+			}
+			void add_digits(uint64_t characters, unsigned count, std::true_type /*is_fraction*/) { to_decimal().add_fraction_digits(characters, count); }
+			void decimal_point() { m_integer = false; }
+			void exponent(char) { m_integer = false; }
+			void exponent_sign(char c) { m_negative_exponent = (c == '-'); }
+			void add_exponent_digit(char c)
+			{
+				// Exponents that large give 0 or infinity anyway, saturate rather than overflow
+				if (m_exponent < 1000000000)
+					m_exponent = m_exponent * 10 + (c - '0');
+			}
+
+			// Result is constructible from uint64_t, int64_t and double
+			// Throws integer_overflow_in_json if the number is an integer that doesn't fit in 64 bits
+			template <class Result> Result value()
+			{
+				if (!m_integer)
+				{
+					to_decimal().add_exponent(m_negative_exponent ? -m_exponent : m_exponent);
+					return m_number.to_double(m_negative);
+				}
+
+				if (m_has_decimal && m_number.truncated())
+					throw integer_overflow_in_json{ "JSON integer too large" };
+				auto integer = m_has_decimal ? m_number.mantissa() : m_integer_part;
+				if (!m_negative)
+					return integer;
+
 				static_assert(std::numeric_limits<int64_t>::min() + 1 == -std::numeric_limits<int64_t>::max(),
 					"our overflow check relies on int64_t range to be [-2^63 .. 2^63-1]");
 				if (integer > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + 1)
 					throw integer_overflow_in_json{ "JSON integer too large" };
 				return -static_cast<int64_t>(integer);
 			}
-			else
+
+		private:
+			floating_point::decimal& to_decimal()
 			{
-				return integer;
+				if (!m_has_decimal)
+				{
+					m_number = floating_point::decimal(m_integer_part);
+					m_has_decimal = true;
+				}
+				return m_number;
 			}
+
+			uint64_t m_integer_part = 0;
+			bool m_has_decimal = false;
+			floating_point::decimal m_number;
+			int64_t m_exponent = 0;
+			bool m_negative = false;
+			bool m_integer = true;
+			bool m_negative_exponent = false;
+		};
+	}
+
+	template <class Stream> variant<uint64_t, int64_t, double> read_number(Stream& s, char first)
+	{
+		details::number_from_stream<Stream> input(s);
+		details::number_value number;
+		details::parse_number(input, first, number);
+		return number.value<variant<uint64_t, int64_t, double>>();
+	}
+
+	/*
+	JSON number kept as text, as found in the document (see read_raw_numbers)
+	The conversion to an integer or a double only happens when the value is requested (as_uint64, as_double... on the document)
+	and the JSON writer writes the text as is, which keeps the exact precision of the number
+	Numbers of up to inline_capacity characters are stored inline
+	*/
+	class raw_number
+	{
+	public:
+		using tag = tags::number;
+		static const size_t inline_capacity = 24;
+
+		const_buffer_ref text() const
+		{
+			if (m_long_text.empty())
+				return{ m_inline_text, m_size };
+			return m_long_text;
 		}
 
-		double decimals = 0;
-		if (floating_point_marker == '.')
+		// Parse the number (throws integer_overflow_in_json if the number is an integer that doesn't fit in 64 bits)
+		variant<uint64_t, int64_t, double> value() const
 		{
-			stream::read<char>(s);
-			decimals = read_decimals(s);
-			floating_point_marker = s.peek<char>();
+			stream::const_buffer_ref_reader s(text());
+			return read_number(s, stream::read<char>(s));
 		}
 
-		double multiplier = 1.;
-		if (floating_point_marker == 'e' || floating_point_marker == 'E')
+		void push_back(char c)
+		{
+			if (m_long_text.empty() && m_size < inline_capacity)
+			{
+				m_inline_text[m_size++] = static_cast<byte>(c);
+				return;
+			}
+			if (m_long_text.empty())
+				m_long_text.assign(m_inline_text, m_inline_text + m_size);
+			m_long_text.push_back(static_cast<byte>(c));
+		}
+		void append(const_buffer_ref text)
 		{
-			stream::read<char>(s);
-			first = stream::read<char>(s);
-			bool negative_exponent = false;
-			if (first == '+' || first == '-')
+			if (m_long_text.empty() && m_size + text.size() <= inline_capacity)
 			{
-				negative_exponent = (first == '-');
-				first = stream::read<char>(s);
+				std::copy(text.begin(), text.end(), m_inline_text + m_size);
+				m_size += text.size();
+				return;
 			}
-			auto exponent_value = read_unsigned_integer(s, first, true /*allow_leading_zeroes*/);
-			multiplier = pow(10., exponent_value);
-			if (negative_exponent)
-				multiplier = 1 / multiplier;
+			if (m_long_text.empty())
+				m_long_text.assign(m_inline_text, m_inline_text + m_size);
+			m_long_text.insert(m_long_text.end(), text.begin(), text.end());
 		}
 
-		return (negative ? -1 : 1) * multiplier * ((double)integer + decimals);
+	private:
+		size_t m_size = 0;
+		byte m_inline_text[inline_capacity];
+		std::vector<byte> m_long_text;
+	};
+
+	namespace details
+	{
+		// Handler of parse_number that keeps the text of the number
+		class raw_number_text
+		{
+		public:
+			raw_number_text(raw_number& number)
+				: m_number(number)
+			{}
+			void negative() { m_number.push_back('-'); }
+			template <class IsFraction> void add_digit(char c, IsFraction) { m_number.push_back(c); }
+			template <class IsFraction> void add_digits(uint64_t characters, unsigned count, IsFraction)
+			{
+				byte text[8];
+				memcpy(text, &characters, sizeof(text));
+				m_number.append({ text, count });
+			}
+			void decimal_point() { m_number.push_back('.'); }
+			void exponent(char c) { m_number.push_back(c); }
+			void exponent_sign(char c) { m_number.push_back(c); }
+			void add_exponent_digit(char c) { m_number.push_back(c); }
+
+		private:
+			raw_number& m_number;
+		};
 	}
 
-	template <class Stream> document<std::decay_t<Stream>> read_no_debug_check(Stream&& s)
+	// Same syntax as read_number, but the number is kept as text
+	template <class Stream> raw_number read_raw_number(Stream& s, char first)
 	{
-		auto c = details::read_non_space(s);
+		raw_number number;
+		details::number_from_stream<Stream> input(s);
+		details::raw_number_text text(number);
+		details::parse_number(input, first, text);
+		return number;
+	}
+
+	namespace details
+	{
+		/*
+		In-place parsing of the tokens that are in the view of a stream that has its data in memory (see stream::has_read_view)
+		The characters are read with local pointers rather than with a peek or a read on the stream for each of them,
+		and the token is consumed from the stream once parsed
+		Tokens that might continue after the end of the view and invalid tokens are left to the stream parser (nothing is consumed then),
+		which reads them across views or reports the error
+		*/
+		inline const byte* skip_spaces_in_place(const byte* it, const byte* end)
+		{
+			while (it != end && (*it == ' ' || *it == '\t' || *it == '\r' || *it == '\n'))
+				++it;
+			return it;
+		}
+		// Returns the end of the literal, or nullptr if the view doesn't start with it
+		template <size_t N> const byte* match_literal_in_place(const byte* it, const byte* end, const char(&literal)[N])
+		{
+			if (static_cast<size_t>(end - it) < N - 1 || memcmp(it, literal, N - 1) != 0)
+				return nullptr;
+			return it + N - 1;
+		}
 
-		switch (c)
+		// Input of parse_number that reads the view with local pointers
+		// The number might continue after the end of the view: parse_number_in_place gives up on the numbers that reach it
+		class number_in_place
 		{
-			case '[': return array<std::decay_t<Stream>>{ std::forward<Stream>(s) };
-			case '{': return map<std::decay_t<Stream>>{ std::forward<Stream>(s) };
-			case 't': details::throw_if_stream_isnt(s, { 'r', 'u', 'e' }); return true;
-			case 'f': details::throw_if_stream_isnt(s, { 'a', 'l', 's', 'e' }); return false;
-			case 'n': details::throw_if_stream_isnt(s, { 'u', 'l', 'l' }); return nullptr;
-			case '"': return text_string<std::decay_t<Stream>>{ std::forward<Stream>(s) };
-			case '-':
-			case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
-				return read_number(s, c).visit([](auto&& x) -> document<Stream> { return x; });
+		public:
+			number_in_place(const byte* it, const byte* end)
+				: m_it(it)
+				, m_end(end)
+			{}
+			char read() { return m_it == m_end ? '\0' : static_cast<char>(*(m_it++)); }
+			char peek() { return m_it == m_end ? '\0' : static_cast<char>(*m_it); }
+			void skip() { ++m_it; }
+			optional<digits> read_up_to_eight_digits()
+			{
+				if (m_end - m_it < 8)
+					return nullopt;
+				auto characters = floating_point::details::load_eight_characters(reinterpret_cast<const char*>(m_it));
+				auto count = floating_point::details::count_leading_digits(characters);
+				m_it += count;
+				return digits{ characters, count };
+			}
+			bool invalid() { return false; }
+
+			const byte* position() const { return m_it; }
+
+		private:
+			const byte* m_it;
+			const byte* m_end;
+		};
 
-			default: throw ill_formatted_json_data{ "Invalid first character for JSON document" };
+		// Handler of parse_number that only checks the syntax, for the raw numbers parsed in place (their text is copied at once)
+		struct number_syntax
+		{
+			void negative() {}
+			template <class IsFraction> void add_digit(char, IsFraction) {}
+			template <class IsFraction> void add_digits(uint64_t, unsigned, IsFraction) {}
+			void decimal_point() {}
+			void exponent(char) {}
+			void exponent_sign(char) {}
+			void add_exponent_digit(char) {}
+		};
+
+		// it points to the '-' or the first digit
+		// Returns the end of the number, or nullptr if the number is invalid or reaches the end of the view (nothing is consumed then)
+		template <class Handler> const byte* parse_number_in_place(const byte* it, const byte* end, Handler& h)
+		{
+			number_in_place input(it + 1, end);
+			// A number that ends with the view might continue after it
+			if (!parse_number(input, static_cast<char>(*it), h) || input.position() == end)
+				return nullptr;
+			return input.position();
 		}
+
+		template <class Stream> document<Stream> number_document(number_value& number, const byte*, const byte*)
+		{
+			return number.value<document<Stream>>();
+		}
+		template <class Stream> document<Stream, true> number_document(number_syntax&, const byte* begin, const byte* end)
+		{
+			raw_number number;
+			number.append({ begin, end });
+			return std::move(number);
+		}
+
+		template <class Stream> document<std::decay_t<Stream>> read_number_document(Stream& s, char first, std::false_type /*raw_numbers*/)
+		{
+			return read_number(s, first).visit([](auto&& x) -> document<std::decay_t<Stream>> { return x; });
+		}
+		template <class Stream> document<std::decay_t<Stream>, true> read_number_document(Stream& s, char first, std::true_type /*raw_numbers*/)
+		{
+			return read_raw_number(s, first);
+		}
+
+		template <bool raw_numbers, class Stream> document<std::decay_t<Stream>, raw_numbers> read_document_from_stream(Stream&& s);
+		template <bool raw_numbers, class Stream> document<std::decay_t<Stream>, raw_numbers> read_document(Stream&& s, std::false_type /*has_read_view*/)
+		{
+			return read_document_from_stream<raw_numbers>(std::forward<Stream>(s));
+		}
+		template <bool raw_numbers, class Stream> document<std::decay_t<Stream>, raw_numbers> read_document(Stream&& s, std::true_type /*has_read_view*/)
+		{
+			// Whitespace, literals and numbers are parsed in place, strings, arrays, maps and the tokens that need it are read from the stream
+			auto view = s.read_view(std::numeric_limits<size_t>::max());
+			auto it = skip_spaces_in_place(view.begin(), view.end());
+			if (it != view.end())
+			{
+				switch (*it)
+				{
+					case 't': if (auto end = match_literal_in_place(it, view.end(), "true")) { s.consume(end - view.begin()); return true; } break;
+					case 'f': if (auto end = match_literal_in_place(it, view.end(), "false")) { s.consume(end - view.begin()); return false; } break;
+					case 'n': if (auto end = match_literal_in_place(it, view.end(), "null")) { s.consume(end - view.begin()); return nullptr; } break;
+					case '-':
+					case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
+					{
+						std::conditional_t<raw_numbers, number_syntax, number_value> number;
+						if (auto end = parse_number_in_place(it, view.end(), number))
+						{
+							auto d = number_document<std::decay_t<Stream>>(number, it, end);
+							s.consume(end - view.begin());
+							return d;
+						}
+						auto first = static_cast<char>(*it);
+						s.consume(it + 1 - view.begin());
+						return read_number_document(s, first, std::integral_constant<bool, raw_numbers>());
+					}
+				}
+			}
+			s.consume(it - view.begin());
+			return read_document_from_stream<raw_numbers>(std::forward<Stream>(s));
+		}
+		template <bool raw_numbers, class Stream> document<std::decay_t<Stream>, raw_numbers> read_document(Stream&& s)
+		{
+			return read_document<raw_numbers>(std::forward<Stream>(s), stream::has_read_view<std::decay_t<Stream>>());
+		}
+
+		template <bool raw_numbers, class Stream> document<std::decay_t<Stream>, raw_numbers> read_document_from_stream(Stream&& s)
+		{
+			auto c = read_non_space(s);
+
+			switch (c)
+			{
+				case '[': return array<std::decay_t<Stream>, raw_numbers>{ std::forward<Stream>(s) };
+				case '{': return map<std::decay_t<Stream>, raw_numbers>{ std::forward<Stream>(s) };
+				case 't': details::throw_if_stream_isnt(s, { 'r', 'u', 'e' }); return true;
+				case 'f': details::throw_if_stream_isnt(s, { 'a', 'l', 's', 'e' }); return false;
+				case 'n': details::throw_if_stream_isnt(s, { 'u', 'l', 'l' }); return nullptr;
+				case '"': return text_string<std::decay_t<Stream>>{ std::forward<Stream>(s) };
+				case '-':
+				case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
+					return read_number_document(s, c, std::integral_constant<bool, raw_numbers>());
+
+				default: throw ill_formatted_json_data{ "Invalid first character for JSON document" };
+			}
+		}
+
+		template <bool raw_numbers, class Stream> document<std::decay_t<Stream>, raw_numbers> read_no_debug_check(Stream&& s)
+		{
+			auto d = read_document<raw_numbers>(std::forward<Stream>(s));
+			instrumentation::record_document<instrumentation::policy_of_t<std::decay_t<Stream>>>(d);
+			return d;
+		}
+	}
+
+	template <class Stream> document<std::decay_t<Stream>> read_no_debug_check(Stream&& s)
+	{
+		return details::read_no_debug_check<false /*raw_numbers*/>(std::forward<Stream>(s));
 	}
 
 	template <class Stream, class error_handler> auto read(Stream&& s, error_handler e)
@@ -472,4 +1101,16 @@ namespace goldfish { namespace json
 		return debug_checks::add_read_checks(read_no_debug_check(std::forward<Stream>(s)), e);
 	}
 	template <class Stream> auto read(Stream&& s) { return read(std::forward<Stream>(s), debug_checks::default_error_handler{}); }
+
+	// Same as read, but numbers are kept as text in the document (raw_number, with the tag tags::number) instead of being converted
+	// to uint64_t, int64_t or double while parsing. This avoids the conversions for numbers that are skipped or copied to a writer
+	template <class Stream> document<std::decay_t<Stream>, true> read_raw_numbers_no_debug_check(Stream&& s)
+	{
+		return details::read_no_debug_check<true /*raw_numbers*/>(std::forward<Stream>(s));
+	}
+	template <class Stream, class error_handler> auto read_raw_numbers(Stream&& s, error_handler e)
+	{
+		return debug_checks::add_read_checks(read_raw_numbers_no_debug_check(std::forward<Stream>(s)), e);
+	}
+	template <class Stream> auto read_raw_numbers(Stream&& s) { return read_raw_numbers(std::forward<Stream>(s), debug_checks::default_error_handler{}); }
 }}
\ No newline at end of file
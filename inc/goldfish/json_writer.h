@@ -1,9 +1,13 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <string>
 #include "array_ref.h"
 #include "base64_stream.h"
 #include "debug_checks_writer.h"
+#include "floating_point.h"
 #include "sax_writer.h"
 #include "stream.h"
 
@@ -13,6 +17,41 @@ namespace goldfish { namespace json
 	template <class Stream> class document_writer;
 	template <class Stream> class key_writer;
 
+	namespace details
+	{
+		inline bool needs_escape(byte c) { return c < 0x20 || c == '"' || c == '\\'; }
+
+		// Returns the first character in [it, end) that can't be written as is in a JSON string (", \ or a control character)
+		inline const byte* find_character_to_escape(const byte* it, const byte* end)
+		{
+			#if defined(GOLDFISH_AVX2)
+			for (; end - it >= 32; it += 32)
+			{
+				auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+				auto control = _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(0x1F)), x);
+				auto quote_or_backslash = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\')));
+				auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(control, quote_or_backslash)));
+				if (mask != 0)
+					return it + count_trailing_zeros(mask);
+			}
+			#endif
+			#if defined(GOLDFISH_AVX2) || defined(GOLDFISH_SSE4_1)
+			for (; end - it >= 16; it += 16)
+			{
+				auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+				auto control = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(0x1F)), x);
+				auto quote_or_backslash = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\\')));
+				auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(control, quote_or_backslash)));
+				if (mask != 0)
+					return it + count_trailing_zeros(mask);
+			}
+			#endif
+			while (it != end && !needs_escape(*it))
+				++it;
+			return it;
+		}
+	}
+
 	template <class Stream> class text_writer
 	{
 	public:
@@ -59,8 +98,7 @@ namespace goldfish { namespace json
 			for (;;)
 			{
 				auto prev = it;
-				while (it != buffer.end() && lookup[*it] == F)
-					++it;
+				it = details::find_character_to_escape(it, buffer.end());
 				m_stream.write_buffer({ prev, it });
 				if (it == buffer.end())
 					break;
@@ -136,43 +174,145 @@ namespace goldfish { namespace json
 
 	namespace details
 	{
-		template <class Stream> void serialize_number(Stream& s, uint64_t x)
+		// Writes the digits of x so that they end at end, two at a time using a table of "00" to "99", and returns the first digit
+		inline byte* format_digits(uint64_t x, byte* end)
 		{
-			if (x < 10)
+			static const char two_digits[] =
+				"0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+				"5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+			while (x >= 100)
+			{
+				auto pair = static_cast<size_t>(x % 100);
+				x /= 100;
+				end -= 2;
+				memcpy(end, two_digits + 2 * pair, 2);
+			}
+			if (x >= 10)
 			{
-				stream::write(s, static_cast<char>('0' + x));
+				end -= 2;
+				memcpy(end, two_digits + 2 * x, 2);
 			}
 			else
 			{
-				//            12345678901234567890
-				static_assert(18446744073709551615 == std::numeric_limits<uint64_t>::max(), "The max value of uint64 fits on 20 base 10 digits");
-				uint8_t buffer[20];
-				uint8_t* it = std::end(buffer);
-				do
-				{
-					--it;
-					*it = '0' + (x % 10);
-					x /= 10;
-				} while (x != 0);
-				s.write_buffer({ it, std::end(buffer) });
+				*(--end) = static_cast<byte>('0' + x);
 			}
+			return end;
+		}
+
+		// Number of base 10 digits of x, from the number of bits of x (log10(2) ~= 1233 / 4096), 0 having 1 digit
+		inline size_t count_digits(uint64_t x)
+		{
+			static const uint64_t powers_of_ten[] = {
+				0ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull, 1000000000ull,
+				10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull, 100000000000000ull, 1000000000000000ull,
+				10000000000000000ull, 100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull,
+			};
+			auto digits = (64 - count_leading_zeros(x | 1)) * 1233 >> 12;
+			return digits + (x < powers_of_ten[digits] ? 0 : 1);
+		}
+
+		// The whole number is formatted in a single token (see stream::write_token)
+		template <class Stream> void serialize_number(Stream& s, uint64_t x)
+		{
+			//            12345678901234567890
+			static_assert(18446744073709551615 == std::numeric_limits<uint64_t>::max(), "The max value of uint64 fits on 20 base 10 digits");
+			stream::write_token<20>(s, [&](byte* output)
+			{
+				auto end = output + count_digits(x);
+				format_digits(x, end);
+				return end;
+			});
 		}
 		template <class Stream> void serialize_number(Stream& s, int64_t x)
 		{
-			if (x < 0)
+			stream::write_token<21>(s, [&](byte* output)
+			{
+				auto absolute_value = x < 0 ? 0 - static_cast<uint64_t>(x) : static_cast<uint64_t>(x);
+				if (x < 0)
+					*(output++) = '-';
+				auto end = output + count_digits(absolute_value);
+				format_digits(absolute_value, end);
+				return end;
+			});
+		}
+		// Shortest representation that reads back as the same double (see floating_point::to_shortest_decimal)
+		// Like Python's repr, the notation is scientific for exponents below -4 or above 15, and there is always a decimal point or an exponent
+		// so that the number reads back as a double rather than an integer
+		inline byte* format_double(double x, byte* it)
+		{
+			if (std::signbit(x))
+			{
+				*(it++) = '-';
+				x = -x;
+			}
+
+			auto decimal = floating_point::to_shortest_decimal(x);
+			byte digits[20];
+			auto digits_end = std::end(digits);
+			auto digits_begin = format_digits(decimal.digits, digits_end);
+			auto count = static_cast<int>(digits_end - digits_begin);
+
+			// x = 0.<digits> * 10^point
+			auto point = count + decimal.exponent;
+			if (point > 0 && point <= 16)
+			{
+				if (point >= count)
+				{
+					it = std::copy(digits_begin, digits_end, it);
+					it = std::fill_n(it, point - count, '0');
+					*(it++) = '.';
+					*(it++) = '0';
+				}
+				else
+				{
+					it = std::copy(digits_begin, digits_begin + point, it);
+					*(it++) = '.';
+					it = std::copy(digits_begin + point, digits_end, it);
+				}
+			}
+			else if (point <= 0 && point > -4)
 			{
-				stream::write(s, '-');
-				serialize_number(s, static_cast<uint64_t>(-x));
+				*(it++) = '0';
+				*(it++) = '.';
+				it = std::fill_n(it, -point, '0');
+				it = std::copy(digits_begin, digits_end, it);
 			}
 			else
 			{
-				serialize_number(s, static_cast<uint64_t>(x));
+				*(it++) = *digits_begin;
+				if (count > 1)
+				{
+					*(it++) = '.';
+					it = std::copy(digits_begin + 1, digits_end, it);
+				}
+				*(it++) = 'e';
+				auto exponent = point - 1;
+				if (exponent < 0)
+				{
+					*(it++) = '-';
+					exponent = -exponent;
+				}
+				if (exponent >= 100)
+					*(it++) = static_cast<byte>('0' + exponent / 100);
+				if (exponent >= 10)
+					*(it++) = static_cast<byte>('0' + exponent / 10 % 10);
+				*(it++) = static_cast<byte>('0' + exponent % 10);
 			}
+			return it;
 		}
+		// JSON has no infinities or NaN, they are written as null (like JavaScript's JSON.stringify)
 		template <class Stream> void serialize_number(Stream& s, double x)
 		{
-			auto string = std::to_string(x);
-			s.write_buffer({ reinterpret_cast<const byte*>(string.data()), string.size() });
+			if (!std::isfinite(x))
+			{
+				s.write_buffer({ reinterpret_cast<const byte*>("null"), 4 });
+				return;
+			}
+
+			stream::write_token<32>(s, [&](byte* it) // at most "-0.000", 17 digits
+			{
+				return format_double(x, it);
+			});
 		}
 	}
 
@@ -239,6 +379,18 @@ namespace goldfish { namespace json
 			stream::write(m_stream, '"');
 			return m_stream.flush();
 		}
+		template <class T> auto write(const T& x, std::enable_if_t<std::is_same<typename T::tag, tags::number>::value>* = nullptr)
+		{
+			stream::write(m_stream, '"');
+			m_stream.write_buffer(x.text());
+			stream::write(m_stream, '"');
+			return m_stream.flush();
+		}
+		template <size_t N> auto write(const key<N>& k)
+		{
+			m_stream.write_buffer(k.json());
+			return m_stream.flush();
+		}
 
 		auto start_binary(uint64_t cb) { return start_binary(); }
 		auto start_string(uint64_t cb) { return start_string(); }
@@ -290,6 +442,17 @@ namespace goldfish { namespace json
 			details::serialize_number(m_stream, x);
 			return m_stream.flush();
 		}
+		// Number kept as text (see json::read_raw_numbers), written as is
+		template <class T> auto write(const T& x, std::enable_if_t<std::is_same<typename T::tag, tags::number>::value>* = nullptr)
+		{
+			m_stream.write_buffer(x.text());
+			return m_stream.flush();
+		}
+		template <size_t N> auto write(const key<N>& k)
+		{
+			m_stream.write_buffer(k.json());
+			return m_stream.flush();
+		}
 
 		auto start_binary(uint64_t cb) { return start_binary(); }
 		auto start_string(uint64_t cb) { return start_string(); }
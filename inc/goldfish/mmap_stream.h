@@ -0,0 +1,218 @@
+#pragma once
+
+#include "array_ref.h"
+#include "common.h"
+#include "stream.h"
+#include <string>
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace goldfish { namespace stream
+{
+	// Hint given to the OS about how the mapped file is going to be read
+	enum class mmap_access
+	{
+		normal,     // no hint
+		sequential, // the file is read from front to back (read ahead aggressively and ask for the whole file to be paged in)
+		random,     // the file is read in random order (for example when seeking through large values), don't read ahead
+	};
+
+	namespace details
+	{
+		// Maps an entire file in memory, read only
+		// The mapping stays valid until the object is destroyed
+		class file_mapping
+		{
+		public:
+			file_mapping(const char* path, mmap_access access)
+			{
+				#ifdef _WIN32
+				open(CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags_from_access(access), nullptr));
+				#else
+				auto fd = ::open(path, O_RDONLY | O_CLOEXEC);
+				if (fd < 0)
+					throw io_exception_with_error_code{ "Error during file open", errno };
+				try
+				{
+					map(fd, access);
+				}
+				catch (...)
+				{
+					::close(fd);
+					throw;
+				}
+				::close(fd);
+				#endif
+			}
+			#ifdef _WIN32
+			file_mapping(const wchar_t* path, mmap_access access)
+			{
+				open(CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags_from_access(access), nullptr));
+			}
+			#endif
+			file_mapping(file_mapping&& rhs)
+				: m_data(rhs.m_data)
+			{
+				rhs.m_data = {};
+			}
+			~file_mapping()
+			{
+				if (m_data.empty())
+					return;
+
+				#ifdef _WIN32
+				UnmapViewOfFile(m_data.data());
+				#else
+				munmap(const_cast<byte*>(m_data.data()), m_data.size());
+				#endif
+			}
+			file_mapping(const file_mapping&) = delete;
+			file_mapping& operator = (const file_mapping&) = delete;
+			file_mapping& operator = (file_mapping&&) = delete;
+
+			const_buffer_ref data() const { return m_data; }
+		private:
+			#ifdef _WIN32
+			static DWORD flags_from_access(mmap_access access)
+			{
+				switch (access)
+				{
+				case mmap_access::sequential: return FILE_FLAG_SEQUENTIAL_SCAN;
+				case mmap_access::random: return FILE_FLAG_RANDOM_ACCESS;
+				default: return FILE_ATTRIBUTE_NORMAL;
+				}
+			}
+			void open(HANDLE file)
+			{
+				if (file == INVALID_HANDLE_VALUE)
+					throw io_exception_with_error_code{ "Error during file open", static_cast<int>(GetLastError()) };
+
+				LARGE_INTEGER size;
+				if (!GetFileSizeEx(file, &size))
+				{
+					auto error = GetLastError();
+					CloseHandle(file);
+					throw io_exception_with_error_code{ "Error while querying the file size", static_cast<int>(error) };
+				}
+
+				// Windows doesn't support mapping empty files, an empty file is simply represented by an empty buffer
+				if (size.QuadPart == 0)
+				{
+					CloseHandle(file);
+					return;
+				}
+				if (static_cast<uint64_t>(size.QuadPart) > std::numeric_limits<size_t>::max())
+				{
+					CloseHandle(file);
+					throw io_exception{ "File too large to be mapped in memory" };
+				}
+
+				// The view keeps a reference on the mapping and the file, so both handles can be closed once the view is created
+				auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				auto error = GetLastError();
+				CloseHandle(file);
+				if (mapping == nullptr)
+					throw io_exception_with_error_code{ "Error while mapping the file", static_cast<int>(error) };
+
+				auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				error = GetLastError();
+				CloseHandle(mapping);
+				if (view == nullptr)
+					throw io_exception_with_error_code{ "Error while mapping the file", static_cast<int>(error) };
+
+				m_data = { reinterpret_cast<const byte*>(view), static_cast<size_t>(size.QuadPart) };
+			}
+			#else
+			void map(int fd, mmap_access access)
+			{
+				struct stat st;
+				if (fstat(fd, &st) != 0)
+					throw io_exception_with_error_code{ "Error while querying the file size", errno };
+
+				// mmap doesn't support mapping empty files, an empty file is simply represented by an empty buffer
+				if (st.st_size == 0)
+					return;
+				if (static_cast<uint64_t>(st.st_size) > std::numeric_limits<size_t>::max())
+					throw io_exception{ "File too large to be mapped in memory" };
+
+				auto size = static_cast<size_t>(st.st_size);
+				auto p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (p == MAP_FAILED)
+					throw io_exception_with_error_code{ "Error while mapping the file", errno };
+				m_data = { reinterpret_cast<const byte*>(p), size };
+
+				// The advice is only a hint, failures are not fatal
+				switch (access)
+				{
+				case mmap_access::sequential:
+					madvise(p, size, MADV_SEQUENTIAL);
+					madvise(p, size, MADV_WILLNEED);
+					break;
+				case mmap_access::random:
+					madvise(p, size, MADV_RANDOM);
+					break;
+				default:
+					break;
+				}
+			}
+			#endif
+
+			const_buffer_ref m_data;
+		};
+	}
+
+	// Reader on a file mapped in memory
+	// This behaves like a const_buffer_ref_reader (peek, read and seek are cheap) but doesn't require
+	// copying the file in memory first, which makes it a good fit to parse very large files
+	// Note that the file shouldn't be truncated while it is mapped
+	class mmap_reader : public const_buffer_ref_reader
+	{
+	public:
+		mmap_reader(const char* path, mmap_access access = mmap_access::sequential)
+			: m_mapping(path, access)
+		{
+			m_data = m_mapping.data();
+		}
+		mmap_reader(const std::string& path, mmap_access access = mmap_access::sequential)
+			: mmap_reader(path.c_str(), access)
+		{}
+		#ifdef _WIN32
+		mmap_reader(const wchar_t* path, mmap_access access = mmap_access::sequential)
+			: m_mapping(path, access)
+		{
+			m_data = m_mapping.data();
+		}
+		mmap_reader(const std::wstring& path, mmap_access access = mmap_access::sequential)
+			: mmap_reader(path.c_str(), access)
+		{}
+		#endif
+		mmap_reader(mmap_reader&& rhs)
+			: m_mapping(std::move(rhs.m_mapping))
+		{
+			m_data = rhs.m_data;
+			rhs.m_data = {};
+		}
+		mmap_reader(const mmap_reader&) = delete;
+		mmap_reader& operator = (const mmap_reader&) = delete;
+		mmap_reader& operator = (mmap_reader&&) = delete;
+
+		// The entire content of the file, independently of how much has been read
+		const_buffer_ref file_data() const { return m_mapping.data(); }
+	private:
+		details::file_mapping m_mapping;
+	};
+}}
\ No newline at end of file
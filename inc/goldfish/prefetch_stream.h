@@ -0,0 +1,213 @@
+#pragma once
+
+#include "array_ref.h"
+#include "common.h"
+#include "stream.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace goldfish { namespace stream
+{
+	// Default size and number of the chunks a prefetch_reader reads ahead
+	static const size_t default_prefetch_chunk_size = 1024 * 1024;
+	static const size_t default_prefetch_chunk_count = 4;
+
+	namespace details
+	{
+		struct prefetch_chunk
+		{
+			std::vector<byte> data;
+			size_t size;
+		};
+
+		/* State shared between the prefetch_reader and its worker thread
+		The worker thread takes chunks from the free list, fills them from the inner stream and queues them in the filled list
+		The reader consumes the filled chunks one at a time and gives them back to the free list once they are fully read */
+		template <class inner> class prefetch_state
+		{
+		public:
+			prefetch_state(inner&& stream, size_t chunk_size, size_t chunk_count)
+				: m_stream(std::move(stream))
+			{
+				assert(chunk_size > 0 && chunk_count > 0);
+				for (size_t i = 0; i < chunk_count; ++i)
+					m_free.push_back({ std::vector<byte>(chunk_size), 0 });
+			}
+
+			// Body of the worker thread
+			void run()
+			{
+				for (;;)
+				{
+					prefetch_chunk chunk;
+					{
+						std::unique_lock<std::mutex> lock(m_mutex);
+						m_condition_variable.wait(lock, [&] { return m_stopped || !m_free.empty(); });
+						if (m_stopped)
+							return;
+						chunk = std::move(m_free.back());
+						m_free.pop_back();
+					}
+
+					// The bytes read before an error are still queued, the error is reported once they are consumed
+					std::exception_ptr error;
+					chunk.size = 0;
+					try
+					{
+						while (chunk.size < chunk.data.size())
+						{
+							auto cb = m_stream.read_partial_buffer({ chunk.data.data() + chunk.size, chunk.data.size() - chunk.size });
+							if (cb == 0)
+								break;
+							chunk.size += cb;
+						}
+					}
+					catch (...)
+					{
+						error = std::current_exception();
+					}
+
+					std::unique_lock<std::mutex> lock(m_mutex);
+					auto end_of_stream = error || chunk.size < chunk.data.size();
+					m_filled.push_back(std::move(chunk));
+					m_error = error;
+					m_done = end_of_stream;
+					m_condition_variable.notify_all();
+					if (end_of_stream)
+						return;
+				}
+			}
+			void stop()
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_stopped = true;
+				m_condition_variable.notify_all();
+			}
+
+			const_buffer_ref read_view(size_t max)
+			{
+				if (max == 0)
+					return{};
+				if (m_remaining.empty() && !next_chunk())
+					return{};
+				return m_remaining.slice_from_front(std::min(max, m_remaining.size()));
+			}
+			void consume(size_t cb)
+			{
+				m_remaining.remove_front(cb);
+			}
+
+		private:
+			bool next_chunk()
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				if (m_has_current)
+				{
+					m_free.push_back(std::move(m_current));
+					m_has_current = false;
+					m_condition_variable.notify_all();
+				}
+
+				for (;;)
+				{
+					m_condition_variable.wait(lock, [&] { return !m_filled.empty() || m_done; });
+					if (m_filled.empty())
+					{
+						if (m_error)
+							std::rethrow_exception(m_error);
+						return false;
+					}
+
+					m_current = std::move(m_filled.front());
+					m_filled.pop_front();
+					m_has_current = true;
+					if (m_current.size > 0)
+					{
+						m_remaining = { m_current.data.data(), m_current.size };
+						return true;
+					}
+
+					// Empty chunk (end of stream reached exactly at a chunk boundary): give it back and look at the next one
+					m_free.push_back(std::move(m_current));
+					m_has_current = false;
+				}
+			}
+
+			inner m_stream;
+
+			std::mutex m_mutex;
+			std::condition_variable m_condition_variable;
+			std::vector<prefetch_chunk> m_free;
+			std::deque<prefetch_chunk> m_filled;
+			std::exception_ptr m_error;
+			bool m_done = false;
+			bool m_stopped = false;
+
+			// Only accessed by the reader
+			prefetch_chunk m_current;
+			bool m_has_current = false;
+			const_buffer_ref m_remaining;
+		};
+	}
+
+	/* Reader that reads the inner stream ahead of the consumer on a worker thread, in chunk_count chunks of chunk_size bytes
+	This allows the latency of the inner stream (disk IO for example) to overlap with the parsing of the data
+	The inner stream is only accessed from the worker thread */
+	template <class inner> class prefetch_reader
+	{
+	public:
+		prefetch_reader(inner&& stream, size_t chunk_size = default_prefetch_chunk_size, size_t chunk_count = default_prefetch_chunk_count)
+			: m_state(std::make_unique<details::prefetch_state<inner>>(std::move(stream), chunk_size, chunk_count))
+			, m_thread([state = m_state.get()] { state->run(); })
+		{}
+		prefetch_reader(prefetch_reader&&) = default;
+		prefetch_reader(const prefetch_reader&) = delete;
+		prefetch_reader& operator = (const prefetch_reader&) = delete;
+		prefetch_reader& operator = (prefetch_reader&&) = delete;
+		~prefetch_reader()
+		{
+			if (m_thread.joinable())
+			{
+				m_state->stop();
+				m_thread.join();
+			}
+		}
+
+		size_t read_partial_buffer(buffer_ref data)
+		{
+			auto view = m_state->read_view(data.size());
+			copy(view, buffer_ref{ data.data(), view.size() });
+			m_state->consume(view.size());
+			return view.size();
+		}
+		const_buffer_ref read_view(size_t max) { return m_state->read_view(max); }
+		void consume(size_t cb) { m_state->consume(cb); }
+		uint64_t seek(uint64_t x)
+		{
+			auto original = x;
+			while (x > 0)
+			{
+				auto view = m_state->read_view(static_cast<size_t>(std::min<uint64_t>(x, std::numeric_limits<size_t>::max())));
+				if (view.empty())
+					break;
+				m_state->consume(view.size());
+				x -= view.size();
+			}
+			return original - x;
+		}
+
+	private:
+		std::unique_ptr<details::prefetch_state<inner>> m_state;
+		std::thread m_thread;
+	};
+	template <class inner> enable_if_reader_t<inner, prefetch_reader<std::decay_t<inner>>> prefetch(inner&& stream, size_t chunk_size = default_prefetch_chunk_size, size_t chunk_count = default_prefetch_chunk_count)
+	{
+		return{ std::forward<inner>(stream), chunk_size, chunk_count };
+	}
+}}
\ No newline at end of file
@@ -1,88 +1,268 @@
 #pragma once
 
 #include "array_ref.h"
+#include "common.h"
 
 #include <atomic>
-#include <condition_variable>
-#include <mutex>
+#include <climits>
+#include <memory>
+#include <thread>
+
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+	#pragma comment(lib, "Synchronization.lib")
+#elif defined(__linux__)
+	#include <linux/futex.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#else
+	#include <condition_variable>
+	#include <mutex>
+#endif
 
 namespace goldfish { namespace stream
 {
 	struct reader_writer_stream_closed : exception { using exception::exception; };
 
+	// Default number of bytes that can be written to a reader writer stream before the writer has to wait for the reader
+	static const size_t default_reader_writer_stream_capacity = 64 * 1024;
+
 	namespace details
 	{
-		/* This acts in a similar manner to a producer consumer queue */
+		inline void cpu_relax()
+		{
+			#if defined(_WIN32)
+			YieldProcessor();
+			#elif defined(__i386__) || defined(__x86_64__)
+			__builtin_ia32_pause();
+			#else
+			std::this_thread::yield();
+			#endif
+		}
+
+		/* Lets a thread sleep until another thread signals that something changed (an "event count")
+		The waiting thread calls prepare_wait, checks its condition again and only then calls wait, so that
+		a notification happening in between is never missed */
+		class wait_point
+		{
+		public:
+			uint32_t prepare_wait()
+			{
+				m_waiters.fetch_add(1);
+				return m_sequence.load();
+			}
+			void wait(uint32_t sequence)
+			{
+				#if defined(_WIN32)
+				while (m_sequence.load() == sequence)
+					WaitOnAddress(&m_sequence, &sequence, sizeof(sequence), INFINITE);
+				#elif defined(__linux__)
+				while (m_sequence.load() == sequence)
+					syscall(SYS_futex, &m_sequence, FUTEX_WAIT_PRIVATE, sequence, nullptr, nullptr, 0);
+				#else
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_condition_variable.wait(lock, [&] { return m_sequence.load() != sequence; });
+				#endif
+				m_waiters.fetch_sub(1);
+			}
+			void cancel_wait()
+			{
+				m_waiters.fetch_sub(1);
+			}
+			void notify()
+			{
+				m_sequence.fetch_add(1);
+				if (m_waiters.load() == 0)
+					return;
+
+				#if defined(_WIN32)
+				WakeByAddressAll(&m_sequence);
+				#elif defined(__linux__)
+				syscall(SYS_futex, &m_sequence, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+				#else
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_condition_variable.notify_all();
+				#endif
+			}
+
+		private:
+			std::atomic<uint32_t> m_sequence{ 0 };
+			std::atomic<uint32_t> m_waiters{ 0 };
+			#if !defined(_WIN32) && !defined(__linux__)
+			std::mutex m_mutex;
+			std::condition_variable m_condition_variable;
+			#endif
+		};
+
+		/* This acts in a similar manner to a producer consumer queue
+		The data is stored in a lock free single producer / single consumer ring buffer, so the writer only has to wait
+		for the reader when the ring is full (and the reader only waits when the ring is empty)
+		Waiting threads spin for a short while before going to sleep */
 		class reader_writer_stream
 		{
 		public:
+			reader_writer_stream(size_t capacity)
+			{
+				// Use a power of 2 capacity so that positions in the ring can be computed with a mask
+				size_t rounded_capacity = 1;
+				while (rounded_capacity < capacity)
+					rounded_capacity *= 2;
+				m_buffer = std::make_unique<byte[]>(rounded_capacity);
+				m_capacity = rounded_capacity;
+			}
+
 			size_t read_partial_buffer(buffer_ref data)
 			{
-				auto original_size = data.size();
-				if (original_size == 0)
+				if (data.empty())
 					return 0;
 
-				std::unique_lock<std::mutex> lock(m_mutex);
-				assert(m_state != state::opened || m_read_buffer == nullptr);
-				m_read_buffer = &data;
-				m_condition_variable.notify_one(); // Wake up the writer (now that m_read_buffer is set)
-				m_condition_variable.wait(lock, [&] { return m_state != state::opened || m_read_buffer == nullptr; });
-				if (m_state == state::terminated)
-					throw reader_writer_stream_closed{ "Failed to read from the reader writer stream because the writer was closed" };
-				return original_size - data.size();
+				auto read_index = m_reader.index.load(std::memory_order_relaxed);
+				if (m_reader.cached_write_index == read_index)
+				{
+					wait_for(m_data_available, [&]
+					{
+						m_reader.cached_write_index = m_writer.index.load(std::memory_order_acquire);
+						return m_reader.cached_write_index != read_index || m_state.load() != state::opened;
+					});
+
+					if (m_reader.cached_write_index == read_index)
+					{
+						// The writer might have written some data before flushing, read the index again now that we know the state
+						auto st = m_state.load();
+						m_reader.cached_write_index = m_writer.index.load(std::memory_order_acquire);
+						if (m_reader.cached_write_index == read_index)
+						{
+							if (st == state::terminated)
+								throw reader_writer_stream_closed{ "Failed to read from the reader writer stream because the writer was closed" };
+							return 0;
+						}
+					}
+				}
+
+				auto cb = std::min<size_t>(m_reader.cached_write_index - read_index, data.size());
+				copy_from_ring(read_index, data.slice_from_front(cb));
+				m_reader.index.store(read_index + cb, std::memory_order_release);
+				m_space_available.notify();
+				return cb;
 			}
 
 			void write_buffer(const_buffer_ref data)
 			{
-				std::unique_lock<std::mutex> lock(m_mutex);
-				assert(m_state != state::flushed);
+				assert(m_state.load() != state::flushed);
 
+				auto write_index = m_writer.index.load(std::memory_order_relaxed);
 				while (!data.empty())
 				{
-					m_condition_variable.wait(lock, [&] { return m_state == state::terminated || m_read_buffer != nullptr; });
-					if (m_state == state::terminated)
+					if (write_index - m_writer.cached_read_index == m_capacity)
+					{
+						wait_for(m_space_available, [&]
+						{
+							m_writer.cached_read_index = m_reader.index.load(std::memory_order_acquire);
+							return write_index - m_writer.cached_read_index != m_capacity || m_state.load() == state::terminated;
+						});
+					}
+					if (m_state.load() == state::terminated)
 						throw reader_writer_stream_closed{ "Failed to write to the reader writer stream because the reader was closed" };
-					assert(m_read_buffer != nullptr);
 
-					auto to_copy = std::min(m_read_buffer->size(), data.size());
-					copy(data.remove_front(to_copy), m_read_buffer->remove_front(to_copy));
-					m_read_buffer = nullptr;
-
-					// Wake up the reader now that m_read_buffer is null
-					m_condition_variable.notify_one();
+					auto cb = std::min<size_t>(m_capacity - (write_index - m_writer.cached_read_index), data.size());
+					copy_to_ring(write_index, data.remove_front(cb));
+					write_index += cb;
+					m_writer.index.store(write_index, std::memory_order_release);
+					m_data_available.notify();
 				}
 			}
 			void flush()
 			{
-				std::unique_lock<std::mutex> lock(m_mutex);
-				assert(m_state != state::flushed);
-				if (m_state == state::terminated)
+				auto expected = state::opened;
+				if (!m_state.compare_exchange_strong(expected, state::flushed))
+				{
+					assert(expected != state::flushed);
 					throw reader_writer_stream_closed{ "Failed to flush to the reader writer stream because the reader was closed" };
-
-				m_state = state::flushed;
-				m_condition_variable.notify_one();
+				}
+				m_data_available.notify();
 			}
 			void terminate()
 			{
-				std::unique_lock<std::mutex> lock(m_mutex);
-				if (m_state == state::opened)
+				auto expected = state::opened;
+				if (m_state.compare_exchange_strong(expected, state::terminated))
 				{
-					m_state = state::terminated;
-					m_condition_variable.notify_one();
+					m_data_available.notify();
+					m_space_available.notify();
 				}
 			}
 
 		private:
-			std::mutex m_mutex;
-			std::condition_variable m_condition_variable;
-			buffer_ref* m_read_buffer;
+			template <class Condition> static void wait_for(wait_point& w, Condition&& condition)
+			{
+				static const int spin_count = 256;
+				for (int i = 0; i < spin_count; ++i)
+				{
+					if (condition())
+						return;
+					cpu_relax();
+				}
+
+				for (;;)
+				{
+					auto sequence = w.prepare_wait();
+					if (condition())
+					{
+						w.cancel_wait();
+						return;
+					}
+					w.wait(sequence);
+				}
+			}
+			void copy_from_ring(size_t read_index, buffer_ref data)
+			{
+				auto offset = read_index & (m_capacity - 1);
+				auto cb_first = std::min(data.size(), m_capacity - offset);
+				copy(const_buffer_ref{ m_buffer.get() + offset, cb_first }, data.remove_front(cb_first));
+				copy(const_buffer_ref{ m_buffer.get(), data.size() }, data);
+			}
+			void copy_to_ring(size_t write_index, const_buffer_ref data)
+			{
+				auto offset = write_index & (m_capacity - 1);
+				auto cb_first = std::min(data.size(), m_capacity - offset);
+				copy(data.remove_front(cb_first), buffer_ref{ m_buffer.get() + offset, cb_first });
+				copy(data, buffer_ref{ m_buffer.get(), data.size() });
+			}
+
+			// The reader and the writer each own a cache line, to avoid false sharing
+			// The index are the total number of bytes read/written, each side caches the last index it saw from the other side
+			static const size_t cache_line_size = 64;
+			struct reader_state
+			{
+				std::atomic<size_t> index{ 0 };
+				size_t cached_write_index = 0;
+			};
+			struct writer_state
+			{
+				std::atomic<size_t> index{ 0 };
+				size_t cached_read_index = 0;
+			};
+
+			alignas(cache_line_size) reader_state m_reader;
+			alignas(cache_line_size) writer_state m_writer;
 
 			enum class state
 			{
 				opened,
 				flushed,
 				terminated,
-			} m_state = state::opened;
+			};
+			alignas(cache_line_size) std::atomic<state> m_state{ state::opened };
+			wait_point m_data_available;
+			wait_point m_space_available;
+
+			std::unique_ptr<byte[]> m_buffer;
+			size_t m_capacity;
 		};
 	}
 
@@ -159,9 +339,10 @@ namespace goldfish { namespace stream
 		reader_on_reader_writer reader;
 		writer_on_reader_writer writer;
 	};
-	inline reader_writer_pair create_reader_writer_stream()
+	// The writer can get up to "capacity" bytes ahead of the reader before it has to wait
+	inline reader_writer_pair create_reader_writer_stream(size_t capacity = default_reader_writer_stream_capacity)
 	{
-		auto inner = std::make_shared<details::reader_writer_stream>();
+		auto inner = std::make_shared<details::reader_writer_stream>(capacity);
 		return{
 			reader_on_reader_writer{inner},
 			writer_on_reader_writer{inner}
@@ -20,6 +20,9 @@ namespace goldfish
 		template <class tag> using type_with_tag_t = tags::type_with_tag_t<tag, types...>;
 		enum { does_json_conversions = _does_json_conversions };
 
+		// Another document type built from the same types: Rebinder::type<does_json_conversions, types...> (see debug_checks::document)
+		template <class Rebinder> using rebind_t = typename Rebinder::template type<_does_json_conversions, types...>;
+
 		template <class... Args> document_impl(Args&&... args)
 			: m_data(std::forward<Args>(args)...)
 		{}
@@ -79,6 +82,7 @@ namespace goldfish
 				[](double x, tags::floating_point) { return x; },
 				[](auto&& x, tags::unsigned_int) { return static_cast<double>(x); },
 				[](auto&& x, tags::signed_int) { return static_cast<double>(x); },
+				[](auto&& x, tags::number) { return x.value().visit([](auto&& x) -> double { return static_cast<double>(x); }); },
 				[](auto&& x, tags::string)
 				{
 					// We need to buffer the stream because read_number uses "peek<char>"
@@ -115,6 +119,13 @@ namespace goldfish
 				[](auto&& x, tags::unsigned_int) { return x; },
 				[](auto&& x, tags::signed_int) { return cast_signed_to_unsigned(x); },
 				[](auto&& x, tags::floating_point) { return cast_double_to_unsigned(x); },
+				[](auto&& x, tags::number)
+				{
+					return x.value().visit(best_match(
+						[](uint64_t x) { return x; },
+						[](int64_t x) { return cast_signed_to_unsigned(x); },
+						[](double x) { return cast_double_to_unsigned(x); }));
+				},
 				[](auto&& x, tags::string)
 				{
 					// We need to buffer the stream because read_number uses "peek<char>"
@@ -175,6 +186,13 @@ namespace goldfish
 				[](auto&& x, tags::signed_int) { return x; },
 				[](auto&& x, tags::unsigned_int) { return cast_unsigned_to_signed(x); },
 				[](auto&& x, tags::floating_point) { return cast_double_to_signed(x); },
+				[](auto&& x, tags::number)
+				{
+					return x.value().visit(best_match(
+						[](int64_t x) { return x; },
+						[](uint64_t x) { return cast_unsigned_to_signed(x); },
+						[](double x) { return cast_double_to_signed(x); }));
+				},
 				[](auto&& x, tags::string)
 				{
 					// We need to buffer the stream because read_number uses "peek<char>"
@@ -296,6 +314,14 @@ namespace goldfish
 		variant<types...> m_data;
 	};
 
+	namespace details
+	{
+		// Strings, arrays and maps that can find their end without parsing their content (like the JSON ones) have a seek_to_end API
+		template <class T> static std::true_type test_has_seek_to_end(decltype(std::declval<T>().seek_to_end())*) { return{}; }
+		template <class T> static std::false_type test_has_seek_to_end(...) { return{}; }
+		template <class T> struct has_seek_to_end : decltype(test_has_seek_to_end<T>(nullptr)) {};
+	}
+
 	template <class Document> std::enable_if_t<tags::has_tag<std::decay_t<Document>, tags::document>::value, void> seek_to_end(Document&& d)
 	{
 		d.visit([&](auto&& x, auto) { seek_to_end(std::forward<decltype(x)>(x)); });
@@ -304,22 +330,23 @@ namespace goldfish
 	template <class type> std::enable_if_t<tags::has_tag<std::decay_t<type>, tags::floating_point>::value, void> seek_to_end(type&&) {}
 	template <class type> std::enable_if_t<tags::has_tag<std::decay_t<type>, tags::unsigned_int>::value, void> seek_to_end(type&&) {}
 	template <class type> std::enable_if_t<tags::has_tag<std::decay_t<type>, tags::signed_int>::value, void> seek_to_end(type&&) {}
+	template <class type> std::enable_if_t<tags::has_tag<std::decay_t<type>, tags::number>::value, void> seek_to_end(type&&) {}
 	template <class type> std::enable_if_t<tags::has_tag<std::decay_t<type>, tags::boolean>::value, void> seek_to_end(type&&) {}
 	template <class type> std::enable_if_t<tags::has_tag<std::decay_t<type>, tags::null>::value, void> seek_to_end(type&&) {}
 	template <class type> std::enable_if_t<tags::has_tag<std::decay_t<type>, tags::binary>::value, void> seek_to_end(type&& x)
 	{
 		stream::seek(x, std::numeric_limits<uint64_t>::max());
 	}
-	template <class type> std::enable_if_t<tags::has_tag<std::decay_t<type>, tags::string>::value, void> seek_to_end(type&& x)
+	template <class type> std::enable_if_t<tags::has_tag<std::decay_t<type>, tags::string>::value && !details::has_seek_to_end<std::decay_t<type>>::value, void> seek_to_end(type&& x)
 	{
 		stream::seek(x, std::numeric_limits<uint64_t>::max());
 	}
-	template <class type> std::enable_if_t<tags::has_tag<std::decay_t<type>, tags::array>::value, void> seek_to_end(type&& x)
+	template <class type> std::enable_if_t<tags::has_tag<std::decay_t<type>, tags::array>::value && !details::has_seek_to_end<std::decay_t<type>>::value, void> seek_to_end(type&& x)
 	{
 		while (auto d = x.read())
 			seek_to_end(*d);
 	}
-	template <class type> std::enable_if_t<tags::has_tag<std::decay_t<type>, tags::map>::value, void> seek_to_end(type&& x)
+	template <class type> std::enable_if_t<tags::has_tag<std::decay_t<type>, tags::map>::value && !details::has_seek_to_end<std::decay_t<type>>::value, void> seek_to_end(type&& x)
 	{
 		while (auto d = x.read_key())
 		{
@@ -327,4 +354,8 @@ namespace goldfish
 			seek_to_end(x.read_value());
 		}
 	}
+	template <class type> std::enable_if_t<details::has_seek_to_end<std::decay_t<type>>::value, void> seek_to_end(type&& x)
+	{
+		x.seek_to_end();
+	}
 }
\ No newline at end of file
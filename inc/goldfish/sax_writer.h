@@ -5,11 +5,87 @@
 #include "tags.h"
 #include <type_traits>
 
+namespace goldfish
+{
+	// Map key known at compile time, encoded once for each format so that writers emit it with a single write_buffer
+	// Typical use: static constexpr auto name = make_key("name"); ... map.write(name, value);
+	template <size_t N> class key
+	{
+	public:
+		constexpr key(const char(&text)[N])
+		{
+			static_assert(N > 0, "Expect null terminated strings");
+
+			// JSON: quoted and escaped
+			m_json[m_json_size++] = '"';
+			for (size_t i = 0; i < N - 1; ++i)
+			{
+				auto c = static_cast<byte>(text[i]);
+				switch (c)
+				{
+				case '\b': append_json_escape('b'); break;
+				case '\t': append_json_escape('t'); break;
+				case '\n': append_json_escape('n'); break;
+				case '\r': append_json_escape('r'); break;
+				case '"': append_json_escape('"'); break;
+				case '\\': append_json_escape('\\'); break;
+				default:
+					if (c < 0x20)
+					{
+						append_json_escape('u');
+						m_json[m_json_size++] = '0';
+						m_json[m_json_size++] = '0';
+						m_json[m_json_size++] = "0123456789ABCDEF"[c / 16];
+						m_json[m_json_size++] = "0123456789ABCDEF"[c % 16];
+					}
+					else
+					{
+						m_json[m_json_size++] = c;
+					}
+				}
+			}
+			m_json[m_json_size++] = '"';
+
+			// CBOR: text string header (major type 3) followed by the UTF-8 bytes
+			auto size = static_cast<uint64_t>(N - 1);
+			auto header_bytes = size <= 23 ? 0 : size <= 0xFF ? 1 : size <= 0xFFFF ? 2 : size <= 0xFFFFFFFF ? 4 : 8;
+			m_cbor[m_cbor_size++] = static_cast<byte>((3 << 5) | (header_bytes == 0 ? size : header_bytes == 1 ? 24 : header_bytes == 2 ? 25 : header_bytes == 4 ? 26 : 27));
+			for (auto i = header_bytes; i > 0; --i)
+				m_cbor[m_cbor_size++] = static_cast<byte>(size >> (8 * (i - 1)));
+			for (size_t i = 0; i < N - 1; ++i)
+				m_cbor[m_cbor_size++] = static_cast<byte>(text[i]);
+		}
+
+		const_buffer_ref json() const { return{ m_json, m_json_size }; }
+		const_buffer_ref cbor() const { return{ m_cbor, m_cbor_size }; }
+
+	private:
+		constexpr void append_json_escape(char c)
+		{
+			m_json[m_json_size++] = '\\';
+			m_json[m_json_size++] = static_cast<byte>(c);
+		}
+
+		byte m_json[6 * N] = {}; // quotes and at most 6 bytes per character (\u00XX)
+		size_t m_json_size = 0;
+		byte m_cbor[N + 8] = {}; // at most 9 bytes of header
+		size_t m_cbor_size = 0;
+	};
+	template <size_t N> constexpr key<N> make_key(const char(&text)[N]) { return{ text }; }
+}
+
 namespace goldfish { namespace sax
 {
 	template <class inner> class document_writer;
 	template <class inner> document_writer<std::decay_t<inner>> make_writer(inner&& writer);
 
+	namespace details
+	{
+		template <class Writer, class T> static std::true_type test_can_write(decltype(std::declval<Writer&>().write(std::declval<T>()))*) { return{}; }
+		template <class Writer, class T> static std::false_type test_can_write(...) { return{}; }
+		template <class Writer, class T> struct can_write : decltype(test_can_write<Writer, T>(nullptr)) {};
+	}
+
 	template <class inner> class array_writer
 	{
 	public:
@@ -136,6 +212,9 @@ namespace goldfish { namespace sax
 			return write(text, N - 1);
 		}
 
+		// Pre-encoded key (see goldfish::key), also accepted as a string value
+		template <size_t N> auto write(const key<N>& k) { return m_writer.write(k); }
+
 		auto start_array(uint64_t size) { return make_array_writer(m_writer.start_array(size)); }
 		auto start_array() { return make_array_writer(m_writer.start_array()); }
 
@@ -147,6 +226,12 @@ namespace goldfish { namespace sax
 			return copy(s, [&](size_t cb) { return start_binary(cb); }, [&] { return start_binary(); });
 		}
 
+		// Numbers kept as text (see json::read_raw_numbers) are written as is by writers that support it (JSON) and converted otherwise
+		template <class T> auto write(T&& x, std::enable_if_t<std::is_same<typename std::decay_t<T>::tag, tags::number>::value>* = nullptr)
+		{
+			return write_number(x, details::can_write<inner, const std::decay_t<T>&>());
+		}
+
 		template <class T> auto write(T&& document, std::enable_if_t<std::is_same<typename std::decay_t<T>::tag, tags::document>::value>* = nullptr)
 		{
 			return document.visit(best_match(
@@ -173,6 +258,7 @@ namespace goldfish { namespace sax
 				[&](auto&& x, tags::floating_point) { return write(x); },
 				[&](auto&& x, tags::unsigned_int) { return write(x); },
 				[&](auto&& x, tags::signed_int) { return write(x); },
+				[&](auto&& x, tags::number) { return write(x); },
 				[&](auto&& x, tags::boolean) { return write(x); },
 				[&](auto&& x, tags::null) { return write(x); }
 			));
@@ -183,6 +269,12 @@ namespace goldfish { namespace sax
 			return serialize_to_goldfish(*this, std::forward<T>(t));
 		}
 	private:
+		template <class T> auto write_number(const T& x, std::true_type /*can_write*/) { return m_writer.write(x); }
+		template <class T> auto write_number(const T& x, std::false_type /*can_write*/)
+		{
+			return x.value().visit([&](auto value) { return write(value); });
+		}
+
 		template <class Stream, class CreateWriterWithSize, class CreateWriterWithoutSize>
 		auto copy(Stream& s, CreateWriterWithSize&& create_writer_with_size, CreateWriterWithoutSize&& create_writer_without_size)
 		{
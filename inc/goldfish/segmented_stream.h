@@ -0,0 +1,276 @@
+#pragma once
+
+#include "array_ref.h"
+#include "common.h"
+#include "stream.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifndef _WIN32
+	#include <sys/uio.h>
+#endif
+
+namespace goldfish { namespace stream
+{
+	// Size of the segments allocated by a segment_pool, unless specified otherwise
+	static const size_t default_segment_size = 64 * 1024;
+
+	// Fixed size segments of memory, recycled once the data they hold is released
+	// A pool can be shared between several segmented_writer (and used from several threads)
+	class segment_pool
+	{
+	public:
+		segment_pool(size_t segment_size = default_segment_size)
+			: m_segment_size(segment_size)
+		{
+			assert(segment_size > 0);
+		}
+		segment_pool(const segment_pool&) = delete;
+		segment_pool& operator = (const segment_pool&) = delete;
+
+		size_t segment_size() const { return m_segment_size; }
+		std::unique_ptr<byte[]> allocate()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!m_free.empty())
+				{
+					auto segment = std::move(m_free.back());
+					m_free.pop_back();
+					return segment;
+				}
+			}
+			return std::unique_ptr<byte[]>(new byte[m_segment_size]);
+		}
+		void release(std::unique_ptr<byte[]> segment)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_free.push_back(std::move(segment));
+		}
+
+	private:
+		size_t m_segment_size;
+		std::mutex m_mutex;
+		std::vector<std::unique_ptr<byte[]>> m_free;
+	};
+
+	// Data produced by a segmented_writer: a list of segments, all full except the last one
+	// The segments go back to the pool when the buffer is destroyed
+	class segmented_buffer
+	{
+	public:
+		segmented_buffer(std::shared_ptr<segment_pool> pool)
+			: m_pool(std::move(pool))
+		{}
+		segmented_buffer(segmented_buffer&&) = default;
+		segmented_buffer& operator = (segmented_buffer&& rhs)
+		{
+			release_segments();
+			m_pool = std::move(rhs.m_pool);
+			m_segments = std::move(rhs.m_segments);
+			m_size = rhs.m_size;
+			rhs.m_segments.clear();
+			rhs.m_size = 0;
+			return *this;
+		}
+		segmented_buffer(const segmented_buffer&) = delete;
+		segmented_buffer& operator = (const segmented_buffer&) = delete;
+		~segmented_buffer()
+		{
+			release_segments();
+		}
+
+		size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+		size_t segment_count() const { return m_segments.size(); }
+		const_buffer_ref segment(size_t i) const
+		{
+			assert(i < m_segments.size());
+			auto segment_size = m_pool->segment_size();
+			return{ m_segments[i].get(), i + 1 == m_segments.size() ? m_size - i * segment_size : segment_size };
+		}
+		std::vector<const_buffer_ref> segments() const
+		{
+			std::vector<const_buffer_ref> result;
+			result.reserve(m_segments.size());
+			for (size_t i = 0; i < m_segments.size(); ++i)
+				result.push_back(segment(i));
+			return result;
+		}
+		#ifndef _WIN32
+		// The segments in the format expected by writev
+		std::vector<iovec> iovecs() const
+		{
+			std::vector<iovec> result;
+			result.reserve(m_segments.size());
+			for (size_t i = 0; i < m_segments.size(); ++i)
+			{
+				auto s = segment(i);
+				result.push_back({ const_cast<byte*>(s.data()), s.size() });
+			}
+			return result;
+		}
+		#endif
+
+		// Copy all the segments in a single contiguous buffer
+		std::vector<byte> flatten() const
+		{
+			std::vector<byte> result(m_size);
+			auto output = result.data();
+			for (size_t i = 0; i < m_segments.size(); ++i)
+			{
+				auto s = segment(i);
+				output = std::copy(s.begin(), s.end(), make_unchecked_array_iterator(output));
+			}
+			return result;
+		}
+
+	private:
+		friend class segmented_writer;
+
+		void release_segments()
+		{
+			for (auto& segment : m_segments)
+				m_pool->release(std::move(segment));
+			m_segments.clear();
+		}
+
+		std::shared_ptr<segment_pool> m_pool;
+		std::vector<std::unique_ptr<byte[]>> m_segments;
+		size_t m_size = 0;
+	};
+
+	// Writer that stores the data in memory, in segments allocated from a pool
+	// Unlike vector_writer, the data is never copied as it grows (and there is no need for twice the memory while growing)
+	class segmented_writer
+	{
+	public:
+		segmented_writer(std::shared_ptr<segment_pool> pool = std::make_shared<segment_pool>())
+			: m_data(std::move(pool))
+		{}
+		segmented_writer(segmented_writer&&) = default;
+		segmented_writer(const segmented_writer&) = delete;
+		segmented_writer& operator = (segmented_writer&&) = default;
+		segmented_writer& operator = (const segmented_writer&) = delete;
+
+		void write_buffer(const_buffer_ref d)
+		{
+			assert(!m_flushed);
+			while (!d.empty())
+			{
+				if (m_free.empty())
+					add_segment();
+				auto cb = std::min(d.size(), m_free.size());
+				copy(d.remove_front(cb), m_free.remove_front(cb));
+				m_data.m_size += cb;
+			}
+		}
+		template <class T> std::enable_if_t<std::is_standard_layout<T>::value && sizeof(T) == 1, void> write(const T& t)
+		{
+			assert(!m_flushed);
+			if (m_free.empty())
+				add_segment();
+			m_free.pop_front() = reinterpret_cast<const byte&>(t);
+			++m_data.m_size;
+		}
+		// Segments are always filled entirely, so a token that doesn't fit in the current one is formatted on the side and then split
+		byte* reserve(size_t cb)
+		{
+			assert(!m_flushed);
+			assert(cb <= max_reserve_size);
+			if (m_free.empty())
+				add_segment();
+			m_reserved_on_the_side = m_free.size() < cb;
+			return m_reserved_on_the_side ? m_side_buffer : m_free.data();
+		}
+		void commit(size_t cb)
+		{
+			assert(!m_flushed);
+			if (m_reserved_on_the_side)
+			{
+				write_buffer({ m_side_buffer, cb });
+			}
+			else
+			{
+				m_free.remove_front(cb);
+				m_data.m_size += cb;
+			}
+		}
+		segmented_buffer flush()
+		{
+			assert(!m_flushed);
+			#ifndef NDEBUG
+			m_flushed = true;
+			#endif
+			m_free = {};
+			return std::move(m_data);
+		}
+		size_t size() const { return m_data.size(); }
+
+	private:
+		void add_segment()
+		{
+			m_data.m_segments.push_back(m_data.m_pool->allocate());
+			m_free = { m_data.m_segments.back().get(), m_data.m_pool->segment_size() };
+		}
+
+		segmented_buffer m_data;
+		buffer_ref m_free;
+		bool m_reserved_on_the_side = false;
+		#ifndef NDEBUG
+		bool m_flushed = false;
+		#endif
+		byte m_side_buffer[max_reserve_size];
+	};
+
+	// Reader on the data of a segmented_buffer, without owning it
+	class segmented_buffer_reader
+	{
+	public:
+		segmented_buffer_reader(const segmented_buffer& data)
+			: m_data(data)
+		{
+			if (m_data.segment_count() > 0)
+				m_current = m_data.segment(0);
+		}
+
+		size_t read_partial_buffer(buffer_ref data)
+		{
+			auto view = read_view(data.size());
+			copy(view, buffer_ref{ data.data(), view.size() });
+			consume(view.size());
+			return view.size();
+		}
+		const_buffer_ref read_view(size_t max)
+		{
+			if (m_current.empty() && m_index + 1 < m_data.segment_count())
+				m_current = m_data.segment(++m_index);
+			return m_current.slice_from_front(std::min(max, m_current.size()));
+		}
+		void consume(size_t cb)
+		{
+			m_current.remove_front(cb);
+		}
+		uint64_t seek(uint64_t x)
+		{
+			auto original = x;
+			while (x > 0)
+			{
+				auto view = read_view(static_cast<size_t>(std::min<uint64_t>(x, std::numeric_limits<size_t>::max())));
+				if (view.empty())
+					break;
+				consume(view.size());
+				x -= view.size();
+			}
+			return original - x;
+		}
+
+	private:
+		const segmented_buffer& m_data;
+		size_t m_index = 0;
+		const_buffer_ref m_current;
+	};
+	inline segmented_buffer_reader read_segmented_buffer(const segmented_buffer& x) { return{ x }; }
+}}
\ No newline at end of file
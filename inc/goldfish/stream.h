@@ -1,9 +1,11 @@
 #pragma once
 
 #include <array>
+#include <limits>
 #include <vector>
 #include "array_ref.h"
 #include "common.h"
+#include "instrumentation.h"
 #include "match.h"
 #include "optional.h"
 
@@ -33,6 +35,22 @@ namespace goldfish { namespace stream
 	template <class T, class elem> static std::false_type test_has_read(...) { return{}; }
 	template <class T, class elem> struct has_read : decltype(test_has_read<T, elem>(nullptr)) {};
 
+	// Readers that already have their data in memory can expose it without copying:
+	// read_view(max) returns up to max bytes from the front of the stream without consuming them (the view is only empty at the end of the stream or if max is 0)
+	// consume(cb) then skips cb bytes, cb being at most the size of the last view
+	// The view is invalidated by any other operation on the stream
+	template <class T> static std::true_type test_has_read_view(decltype(std::declval<T>().read_view(size_t{}), std::declval<T>().consume(size_t{}))*) { return{}; }
+	template <class T> static std::false_type test_has_read_view(...) { return{}; }
+	template <class T> struct has_read_view : decltype(test_has_read_view<T>(nullptr)) {};
+
+	// Writers that can hand out their output memory directly:
+	// reserve(cb) returns room for cb bytes (cb being at most max_reserve_size), to be filled before calling commit(used) with used <= cb
+	// No other operation can happen on the stream between reserve and commit
+	static const size_t max_reserve_size = 64;
+	template <class T> static std::true_type test_has_reserve(decltype(std::declval<T>().reserve(size_t{}), std::declval<T>().commit(size_t{}))*) { return{}; }
+	template <class T> static std::false_type test_has_reserve(...) { return{}; }
+	template <class T> struct has_reserve : decltype(test_has_reserve<T>(nullptr)) {};
+
 	template <class Stream> enable_if_reader_t<Stream, size_t> read_full_buffer(Stream&& s, buffer_ref buffer)
 	{
 		auto cur = buffer.begin();
@@ -46,22 +64,31 @@ namespace goldfish { namespace stream
 		return cur - buffer.begin();
 	}
 
+	namespace details
+	{
+		// Skip x bytes by reading them, used by streams that can't seek (or can't seek in some cases, like file streams on pipes)
+		template <class Stream> uint64_t seek_by_reading(Stream& s, uint64_t x)
+		{
+			auto original = x;
+			byte buffer[typical_buffer_length];
+			while (x > 0)
+			{
+				auto cb = s.read_partial_buffer({ buffer, static_cast<size_t>(std::min<uint64_t>(sizeof(buffer), x)) });
+				if (cb == 0)
+					break;
+				x -= cb;
+			}
+			return original - x;
+		}
+	}
+
 	template <class Stream> std::enable_if_t< has_seek<Stream>::value, uint64_t> seek(Stream& s, uint64_t x)
 	{
 		return s.seek(x);
 	}
 	template <class Stream> std::enable_if_t<!has_seek<Stream>::value, uint64_t> seek(Stream& s, uint64_t x)
 	{
-		auto original = x;
-		byte buffer[typical_buffer_length];
-		while (x > 0)
-		{
-			auto cb = s.read_partial_buffer({ buffer, static_cast<size_t>(std::min<uint64_t>(sizeof(buffer), x)) });
-			if (cb == 0)
-				break;
-			x -= cb;
-		}
-		return original - x;
+		return details::seek_by_reading(s, x);
 	}
 
 	template <class T, class Stream> std::enable_if_t< has_read<Stream, T>::value && std::is_standard_layout<T>::value, T> read(Stream& s)
@@ -83,6 +110,28 @@ namespace goldfish { namespace stream
 		s.write_buffer({ reinterpret_cast<const byte*>(&t), sizeof(t) });
 	}
 
+	namespace details
+	{
+		template <size_t max_size, class Stream, class Format> void write_token(Stream& s, Format&& format, std::true_type /*has_reserve*/)
+		{
+			auto output = s.reserve(max_size);
+			s.commit(format(output) - output);
+		}
+		template <size_t max_size, class Stream, class Format> void write_token(Stream& s, Format&& format, std::false_type /*has_reserve*/)
+		{
+			byte buffer[max_size];
+			s.write_buffer({ buffer, format(buffer) });
+		}
+	}
+
+	// Writes a token of at most max_size bytes: format(output) writes it at output and returns its end
+	// The token is formatted straight into the output of writers that support reserve, and on the stack for the others
+	template <size_t max_size, class Stream, class Format> void write_token(Stream& s, Format&& format)
+	{
+		static_assert(max_size <= max_reserve_size, "Tokens are expected to be small");
+		details::write_token<max_size>(s, format, has_reserve<Stream>());
+	}
+
 	template <class inner> class ref_reader;
 	template <class inner> class ref_writer;
 	template <class T> struct is_ref : std::false_type {};
@@ -93,6 +142,7 @@ namespace goldfish { namespace stream
 	{
 	public:
 		static_assert(!is_ref<inner>::value, "Don't nest ref");
+		using instrumentation_policy = instrumentation::policy_of_t<inner>;
 
 		ref_reader(inner& stream)
 			: m_stream(stream)
@@ -101,6 +151,8 @@ namespace goldfish { namespace stream
 		template <class T> auto read() { return stream::read<T>(m_stream); }
 		uint64_t seek(uint64_t x) { return stream::seek(m_stream, x); }
 		template <class T> auto peek() { return m_stream.peek<T>(); }
+		template <class S = inner> std::enable_if_t<has_read_view<S>::value, const_buffer_ref> read_view(size_t max) { return m_stream.read_view(max); }
+		template <class S = inner> std::enable_if_t<has_read_view<S>::value, void> consume(size_t cb) { m_stream.consume(cb); }
 	private:
 		inner& m_stream;
 	};
@@ -109,12 +161,15 @@ namespace goldfish { namespace stream
 	{
 	public:
 		static_assert(!is_ref<inner>::value, "Don't nest ref");
+		using instrumentation_policy = instrumentation::policy_of_t<inner>;
 
 		ref_writer(inner& stream)
 			: m_stream(stream)
 		{}
 		void write_buffer(const_buffer_ref data) { return m_stream.write_buffer(data); }
 		template <class T> auto write(const T& t) { return stream::write(m_stream, t); }
+		template <class S = inner> std::enable_if_t<has_reserve<S>::value, byte*> reserve(size_t cb) { return m_stream.reserve(cb); }
+		template <class S = inner> std::enable_if_t<has_reserve<S>::value, void> commit(size_t cb) { m_stream.commit(cb); }
 
 		// Note that the ref_writer doesn't flush
 		// The actual owner of the stream should be the one flushing
@@ -159,6 +214,14 @@ namespace goldfish { namespace stream
 			m_data.remove_front(to_seek);
 			return to_seek;
 		}
+		const_buffer_ref read_view(size_t max)
+		{
+			return m_data.slice_from_front(std::min(max, m_data.size()));
+		}
+		void consume(size_t cb)
+		{
+			m_data.remove_front(cb);
+		}
 
 		template <class T> std::enable_if_t<std::is_standard_layout<T>::value, T> read()
 		{
@@ -259,6 +322,8 @@ namespace goldfish { namespace stream
 	inline string_reader read_string(std::string x) { return{ std::move(x) }; }
 	template <size_t N> auto read_string(const char(&s)[N]) { return read_string_ref(s); }
 
+	// vector_writer and string_writer don't support reserve: the container can't grow without value-initializing the new bytes
+	// Front them with a buffered_writer to format tokens straight into the output
 	class vector_writer
 	{
 	public:
@@ -271,8 +336,7 @@ namespace goldfish { namespace stream
 		void write_buffer(const_buffer_ref d)
 		{
 			assert(!m_flushed);
-			if (m_data.capacity() - m_data.size() < d.size())
-				m_data.reserve(m_data.capacity() + m_data.capacity() / 2);
+			grow(d.size());
 			m_data.insert(m_data.end(), d.begin(), d.end());
 		}
 		auto flush()
@@ -294,6 +358,12 @@ namespace goldfish { namespace stream
 			return m_data;
 		}
 	private:
+		void grow(size_t cb)
+		{
+			if (m_data.capacity() - m_data.size() < cb)
+				m_data.reserve(std::max(m_data.capacity() + m_data.capacity() / 2, m_data.size() + cb));
+		}
+
 		#ifndef NDEBUG
 		bool m_flushed = false;
 		#endif
@@ -311,9 +381,7 @@ namespace goldfish { namespace stream
 		void write_buffer(const_buffer_ref d)
 		{
 			assert(!m_flushed);
-			if (m_data.capacity() - m_data.size() < d.size())
-				m_data.reserve(m_data.capacity() + m_data.capacity() / 2);
-
+			grow(d.size());
 			m_data.append(reinterpret_cast<const char*>(d.begin()), reinterpret_cast<const char*>(d.end()));
 		}
 		template <class T> std::enable_if_t<std::is_standard_layout<T>::value && sizeof(T) == 1, void> write(const T& t)
@@ -335,6 +403,12 @@ namespace goldfish { namespace stream
 			return m_data;
 		}
 	private:
+		void grow(size_t cb)
+		{
+			if (m_data.capacity() - m_data.size() < cb)
+				m_data.reserve(std::max(m_data.capacity() + m_data.capacity() / 2, m_data.size() + cb));
+		}
+
 		#ifndef NDEBUG
 		bool m_flushed = false;
 		#endif
@@ -355,11 +429,31 @@ namespace goldfish { namespace stream
 		return output.flush();
 	}
 
+	namespace details
+	{
+		template <class Reader, class Writer> void copy_stream(Reader& r, Writer& w, std::false_type /*has_read_view*/)
+		{
+			byte buffer[typical_buffer_length];
+			while (auto cb = r.read_partial_buffer(buffer))
+				w.write_buffer({ buffer, cb });
+		}
+		template <class Reader, class Writer> void copy_stream(Reader& r, Writer& w, std::true_type /*has_read_view*/)
+		{
+			// Forward the data of the reader to the writer directly, without going through an intermediate buffer
+			for (;;)
+			{
+				auto view = r.read_view(std::numeric_limits<size_t>::max());
+				if (view.empty())
+					break;
+				w.write_buffer(view);
+				r.consume(view.size());
+			}
+		}
+	}
+
 	template <class Reader, class Writer>
 	std::enable_if_t<is_reader<std::decay_t<Reader>>::value && is_writer<std::decay_t<Writer>>::value, void> copy(Reader&& r, Writer&& w)
 	{
-		byte buffer[typical_buffer_length];
-		while (auto cb = r.read_partial_buffer(buffer))
-			w.write_buffer({ buffer, cb });
+		details::copy_stream(r, w, has_read_view<std::decay_t<Reader>>());
 	}
 }}
@@ -15,6 +15,7 @@ namespace goldfish { namespace tags
 	struct floating_point {}; template <> struct is_tag<floating_point> : std::true_type {};
 	struct unsigned_int {};   template <> struct is_tag<unsigned_int> : std::true_type {};
 	struct signed_int {};     template <> struct is_tag<signed_int> : std::true_type {};
+	struct number {};         template <> struct is_tag<number> : std::true_type {}; // number kept as text, converted on demand (see json::read_raw_numbers)
 	struct boolean {};        template <> struct is_tag<boolean> : std::true_type {};
 	struct null {};           template <> struct is_tag<null> : std::true_type {};
 	struct document {};       template <> struct is_tag<document> : std::true_type {};
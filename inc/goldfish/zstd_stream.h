@@ -0,0 +1,140 @@
+#pragma once
+
+#include "array_ref.h"
+#include "common.h"
+#include "stream.h"
+
+#include <memory>
+#include <new>
+#include <vector>
+#include <zstd.h>
+#include <zstd_errors.h>
+
+// Requires libzstd (https://facebook.github.io/zstd), the application needs to link against it
+namespace goldfish { namespace stream
+{
+	struct ill_formatted_zstd_data : ill_formatted { using ill_formatted::ill_formatted; };
+
+	namespace details
+	{
+		struct zstd_dctx_deleter { void operator()(ZSTD_DCtx* p) const { ZSTD_freeDCtx(p); } };
+		struct zstd_cctx_deleter { void operator()(ZSTD_CCtx* p) const { ZSTD_freeCCtx(p); } };
+
+		// zstd error names are static strings, they can be used as the exception message
+		inline size_t check_zstd_result(size_t result)
+		{
+			if (ZSTD_isError(result))
+				throw io_exception_with_error_code{ ZSTD_getErrorName(result), static_cast<int>(ZSTD_getErrorCode(result)) };
+			return result;
+		}
+	}
+
+	// Reads the data decompressed from a zstd stream
+	// Concatenated frames are read as a single stream
+	template <class inner> class zstd_reader
+	{
+	public:
+		zstd_reader(inner&& stream)
+			: m_stream(std::move(stream))
+			, m_context(ZSTD_createDCtx())
+			, m_buffer(ZSTD_DStreamInSize())
+		{
+			if (!m_context)
+				throw std::bad_alloc();
+		}
+
+		size_t read_partial_buffer(buffer_ref data)
+		{
+			ZSTD_outBuffer output = { data.data(), data.size(), 0 };
+			while (output.pos < output.size && output.pos == 0)
+			{
+				auto end_of_input = (m_input.pos == m_input.size && !fill_in_buffer());
+				if (end_of_input && !m_in_frame)
+					break;
+
+				// Once all the input is consumed, zstd might still have decompressed data to flush: the stream is only
+				// truncated if a call with no more input makes no progress
+				auto input_pos = m_input.pos;
+				auto result = ZSTD_decompressStream(m_context.get(), &output, &m_input);
+				if (ZSTD_isError(result))
+					throw ill_formatted_zstd_data{ ZSTD_getErrorName(result) };
+				m_in_frame = (result != 0); // 0 means the end of a frame was reached
+				if (end_of_input && output.pos == 0 && m_input.pos == input_pos)
+				{
+					if (m_in_frame)
+						throw ill_formatted_zstd_data{ "Unexpected end of zstd stream" };
+					break;
+				}
+			}
+			return output.pos;
+		}
+
+	private:
+		bool fill_in_buffer()
+		{
+			m_input = { m_buffer.data(), m_stream.read_partial_buffer(m_buffer), 0 };
+			return m_input.size > 0;
+		}
+
+		inner m_stream;
+		std::unique_ptr<ZSTD_DCtx, details::zstd_dctx_deleter> m_context;
+		std::vector<byte> m_buffer;
+		ZSTD_inBuffer m_input = { nullptr, 0, 0 };
+		bool m_in_frame = false;
+	};
+
+	// Compresses the data written to it in the zstd format before writing it to inner, with a checksum of the content
+	// If worker_count is not 0, compression happens on worker_count background threads while the data is being written
+	// (this requires libzstd to be built with multi-threading support)
+	// The end of the frame is only written on flush
+	template <class inner> class zstd_writer
+	{
+	public:
+		zstd_writer(inner&& stream, int compression_level = ZSTD_CLEVEL_DEFAULT, int worker_count = 0)
+			: m_stream(std::move(stream))
+			, m_context(ZSTD_createCCtx())
+			, m_buffer(ZSTD_CStreamOutSize())
+		{
+			if (!m_context)
+				throw std::bad_alloc();
+			details::check_zstd_result(ZSTD_CCtx_setParameter(m_context.get(), ZSTD_c_compressionLevel, compression_level));
+			details::check_zstd_result(ZSTD_CCtx_setParameter(m_context.get(), ZSTD_c_checksumFlag, 1)); // like gzip, detect corrupted data
+			if (worker_count != 0)
+				details::check_zstd_result(ZSTD_CCtx_setParameter(m_context.get(), ZSTD_c_nbWorkers, worker_count));
+		}
+
+		void write_buffer(const_buffer_ref data)
+		{
+			ZSTD_inBuffer input = { data.data(), data.size(), 0 };
+			while (input.pos < input.size)
+				compress_to_inner(input, ZSTD_e_continue);
+		}
+		auto flush()
+		{
+			ZSTD_inBuffer input = { nullptr, 0, 0 };
+			while (compress_to_inner(input, ZSTD_e_end) != 0) {}
+			return m_stream.flush();
+		}
+
+	private:
+		// Returns the amount of data zstd still has to write (only meaningful when ending the frame)
+		size_t compress_to_inner(ZSTD_inBuffer& input, ZSTD_EndDirective mode)
+		{
+			ZSTD_outBuffer output = { m_buffer.data(), m_buffer.size(), 0 };
+			auto remaining = details::check_zstd_result(ZSTD_compressStream2(m_context.get(), &output, &input, mode));
+			if (output.pos > 0)
+				m_stream.write_buffer({ m_buffer.data(), output.pos });
+			return remaining;
+		}
+
+		inner m_stream;
+		std::unique_ptr<ZSTD_CCtx, details::zstd_cctx_deleter> m_context;
+		std::vector<byte> m_buffer;
+	};
+
+	template <class inner> enable_if_reader_t<inner, zstd_reader<std::decay_t<inner>>> decompress_zstd(inner&& stream) { return{ std::forward<inner>(stream) }; }
+	template <class inner> enable_if_writer_t<inner, zstd_writer<std::decay_t<inner>>> compress_zstd_to(inner&& stream, int compression_level = ZSTD_CLEVEL_DEFAULT, int worker_count = 0)
+	{
+		return{ std::forward<inner>(stream), compression_level, worker_count };
+	}
+}}
\ No newline at end of file
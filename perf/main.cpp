@@ -1,9 +1,11 @@
 #include <iostream>
 #include <numeric>
 #include <chrono>
+#include <stdio.h>
 
 #include <goldfish/stream.h>
-#include <goldfish/file_stream.h>
+#include <goldfish/base64_stream.h>
+#include <goldfish/mmap_stream.h>
 #include <goldfish/json_reader.h>
 #include <goldfish/json_writer.h>
 #include <goldfish/cbor_reader.h>
@@ -23,16 +25,22 @@ auto measure_one(const Lambda& l)
 template <class Lambda>
 void measure(Lambda&& l, size_t document_size)
 {
-	vector<chrono::milliseconds> durations;
+	vector<chrono::duration<double, milli>> durations;
 	auto start = chrono::high_resolution_clock::now();
 	do
 	{
-		durations.push_back(chrono::duration_cast<chrono::milliseconds>(measure_one(l)));
+		durations.push_back(measure_one(l));
 	} while (chrono::high_resolution_clock::now() - start < chrono::seconds(10));
 
 	sort(durations.begin(), durations.end());
-	double average_duration = (double)accumulate(durations.begin(), durations.end(), chrono::milliseconds(0)).count() / durations.size();
-	cout << "average: " << average_duration << "ms (" << document_size / (average_duration * 1000) << "MB/s) on " << durations.size() << " samples\n";
+	double average_duration = accumulate(durations.begin(), durations.end(), chrono::duration<double, milli>(0)).count() / durations.size();
+	double throughput = document_size / (average_duration * 1000);
+	cout << "average: " << average_duration << "ms (";
+	if (throughput >= 1000)
+		cout << throughput / 1000 << "GB/s";
+	else
+		cout << throughput << "MB/s";
+	cout << ") on " << durations.size() << " samples\n";
 	cout << "best: " << durations.front().count() << "ms\tworst: " << durations.back().count() << "ms\n";
 }
 
@@ -61,6 +69,238 @@ template <class Document> int64_t sum_ints(Document&& t)
 		[](auto& x, auto tag) { goldfish::seek_to_end(x); return 0ll; }));
 }
 
+template <class Document> double sum_doubles(Document&& t)
+{
+	return t.visit(first_match(
+		[](double x, tags::floating_point) { return x; },
+		[](auto& x, tags::array)
+		{
+			double sum = 0;
+			while (auto d = x.read())
+				sum += sum_doubles(*d);
+			return sum;
+		},
+		[](auto& x, tags::map)
+		{
+			double sum = 0;
+			while (auto key = x.read_key())
+			{
+				goldfish::seek_to_end(*key);
+				sum += sum_doubles(x.read_value());
+			}
+			return sum;
+		},
+		[](auto& x, auto tag) { goldfish::seek_to_end(x); return 0.; }));
+}
+
+// Writer that drops the data, to measure the cost of producing it
+struct null_writer
+{
+	void write_buffer(const_buffer_ref data) { size += data.size(); }
+	auto flush() { return size; }
+	size_t size = 0;
+};
+
+// Synthetic document shaped like canada.json (a GeoJSON polygon): mostly arrays of [longitude, latitude] pairs with 15 to 17 significant digits
+void measure_floating_point()
+{
+	string json_data = "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[";
+	vector<double> doubles;
+	uint32_t seed = 0;
+	auto random = [&] { seed = seed * 1103515245 + 12345; return (seed >> 8) / double(1 << 24); };
+	for (int ring = 0; ring < 480; ++ring)
+	{
+		json_data += ring == 0 ? "[" : ",[";
+		for (int point = 0; point < 1000; ++point)
+		{
+			char text[64];
+			auto longitude = -141 + 88 * random();
+			auto latitude = 41 + 42 * random();
+			snprintf(text, sizeof(text), "%s[%.15f,%.15f]", point == 0 ? "" : ",", longitude, latitude);
+			json_data += text;
+			doubles.push_back(longitude);
+			doubles.push_back(latitude);
+		}
+		json_data += "]";
+	}
+	json_data += "]}}]}";
+
+	cout << "\nFLOATING POINT\n";
+
+	cout << "\nDeserialize a canada.json like document\n";
+	measure([&]
+	{
+		return sum_doubles(json::read(stream::read_string_ref(json_data)));
+	}, json_data.size());
+
+	cout << "\nCopy a canada.json like document to JSON\n";
+	measure([&]
+	{
+		return json::create_writer(null_writer{}).write(json::read(stream::read_string_ref(json_data)));
+	}, json_data.size());
+
+	cout << "\nCopy a canada.json like document to JSON, keeping numbers as text\n";
+	measure([&]
+	{
+		return json::create_writer(null_writer{}).write(json::read_raw_numbers(stream::read_string_ref(json_data)));
+	}, json_data.size());
+
+	cout << "\nSerialize the doubles of a canada.json like document to JSON\n";
+	auto serialize_doubles = [&]
+	{
+		auto array = json::create_writer(null_writer{}).start_array();
+		for (auto x : doubles)
+			array.write(x);
+		return array.flush();
+	};
+	measure(serialize_doubles, serialize_doubles());
+}
+
+// Integers shaped like metrics and identifiers: mostly small counters, some timestamps and 64 bits hashes
+void measure_integers()
+{
+	vector<uint64_t> unsigned_integers;
+	vector<int64_t> signed_integers;
+	uint64_t seed = 0;
+	auto random = [&] { seed = seed * 6364136223846793005ull + 1442695040888963407ull; return seed; };
+	for (int i = 0; i < 4 * 1024 * 1024; ++i)
+	{
+		auto x = random();
+		switch (x % 4)
+		{
+		case 0: unsigned_integers.push_back((x >> 32) % 1000); break;
+		case 1: unsigned_integers.push_back((x >> 32) % 1000000); break;
+		case 2: unsigned_integers.push_back(1500000000000 + (x >> 24) % 100000000000); break;
+		case 3: unsigned_integers.push_back(x); break;
+		}
+		signed_integers.push_back(static_cast<int64_t>(unsigned_integers.back() >> (x % 64)) * ((x & 1) ? 1 : -1));
+	}
+
+	cout << "\nINTEGERS\n";
+
+	cout << "\nSerialize unsigned integers to JSON\n";
+	auto serialize_unsigned = [&]
+	{
+		auto array = json::create_writer(null_writer{}).start_array();
+		for (auto x : unsigned_integers)
+			array.write(x);
+		return array.flush();
+	};
+	measure(serialize_unsigned, serialize_unsigned());
+
+	cout << "\nSerialize signed integers to JSON\n";
+	auto serialize_signed = [&]
+	{
+		auto array = json::create_writer(null_writer{}).start_array();
+		for (auto x : signed_integers)
+			array.write(x);
+		return array.flush();
+	};
+	measure(serialize_signed, serialize_signed());
+}
+
+// Prose like strings: long runs of plain ASCII and UTF-8 text, with an occasional quote or line break to escape
+void measure_strings()
+{
+	vector<string> strings;
+	size_t text_size = 0;
+	uint32_t seed = 0;
+	auto random = [&] { seed = seed * 1103515245 + 12345; return seed >> 8; };
+	for (int i = 0; i < 16 * 1024; ++i)
+	{
+		string text;
+		auto length = 64 + random() % 4096;
+		while (text.size() < length)
+		{
+			switch (random() % 64)
+			{
+			case 0: text += "\"quoted\""; break;
+			case 1: text += "\n"; break;
+			case 2: text += u8"caf\u00E9 "; break;
+			default: text += "lorem ipsum "; break;
+			}
+		}
+		text_size += text.size();
+		strings.push_back(move(text));
+	}
+
+	cout << "\nSTRINGS\n";
+
+	cout << "\nSerialize long strings to JSON\n";
+	measure([&]
+	{
+		auto array = json::create_writer(null_writer{}).start_array();
+		for (auto& x : strings)
+			array.write(x);
+		return array.flush();
+	}, text_size);
+}
+
+// Records with the same few keys, like logs or metrics
+void measure_constant_keys()
+{
+	static constexpr auto id = make_key("id");
+	static constexpr auto name = make_key("name");
+	static constexpr auto timestamp = make_key("timestamp");
+	static constexpr auto value = make_key("value");
+	auto serialize = [](auto&& writer)
+	{
+		auto array = writer.start_array();
+		for (uint64_t i = 0; i < 1024 * 1024; ++i)
+		{
+			auto map = array.start_map();
+			map.write(id, i);
+			map.write(name, "sensor");
+			map.write(timestamp, 1500000000000 + i);
+			map.write(value, i % 100);
+			map.flush();
+		}
+		return array.flush();
+	};
+
+	cout << "\nCONSTANT KEYS\n";
+
+	cout << "\nSerialize records with constant keys to JSON\n";
+	measure([&] { return serialize(json::create_writer(null_writer{})); }, serialize(json::create_writer(null_writer{})));
+
+	cout << "\nSerialize records with constant keys to CBOR\n";
+	measure([&] { return serialize(cbor::create_writer(null_writer{})); }, serialize(cbor::create_writer(null_writer{})));
+}
+
+void measure_base64()
+{
+	vector<goldfish::byte> binary_data(64 * 1024 * 1024);
+	uint32_t seed = 0;
+	for (auto& x : binary_data)
+	{
+		seed = seed * 1103515245 + 12345;
+		x = static_cast<goldfish::byte>(seed >> 16);
+	}
+	auto base64_data = [&]
+	{
+		auto s = stream::encode_base64_to(stream::vector_writer{});
+		s.write_buffer(binary_data);
+		return s.flush();
+	}();
+
+	cout << "\nBASE64\n";
+
+	cout << "\nEncode base64\n";
+	measure([&]
+	{
+		auto s = stream::encode_base64_to(null_writer{});
+		s.write_buffer(binary_data);
+		return s.flush();
+	}, binary_data.size());
+
+	cout << "\nDecode base64\n";
+	vector<goldfish::byte> decoded(binary_data.size());
+	measure([&]
+	{
+		return stream::read_full_buffer(stream::decode_base64(stream::read_buffer_ref(base64_data)), decoded);
+	}, base64_data.size());
+}
+
 int main(int argc, char* argv[])
 {
 	if (argc != 2)
@@ -69,7 +309,8 @@ int main(int argc, char* argv[])
 		return 0;
 	}
 
-	auto json_data = stream::read_all(stream::file_reader(argv[1]));
+	stream::mmap_reader json_file(argv[1]);
+	auto json_data = json_file.file_data();
 	auto cbor_data = [&]
 	{
 		auto document = json::read(stream::read_buffer_ref(json_data));
@@ -92,5 +333,17 @@ int main(int argc, char* argv[])
 	{
 		return sum_ints(json::read(stream::read_buffer_ref(json_data)));
 	}, json_data.size());
+
+	cout << "\nSkip the JSON document without parsing it\n";
+	measure([&]
+	{
+		goldfish::seek_to_end(json::read(stream::read_buffer_ref(json_data)));
+	}, json_data.size());
+
+	measure_floating_point();
+	measure_integers();
+	measure_strings();
+	measure_constant_keys();
+	measure_base64();
 }
 
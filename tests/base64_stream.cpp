@@ -38,6 +38,63 @@ namespace goldfish { namespace stream
 	TEST_CASE(base64_decode_wrong_padding_size_3) { expect_exception<ill_formatted_base64_data>([] { my_base64_decode("===="); }); }
 	TEST_CASE(base64_padding_in_middle) { expect_exception<ill_formatted_base64_data>([] { my_base64_decode("cw==cw=="); }); }
 
+	TEST_CASE(base64_round_trip_large)
+	{
+		// Covers the vectorized blocks, the scalar tail and the different amounts of padding
+		for (size_t size : { 11, 12, 13, 24, 33, 47, 48, 49, 100, 1000, 8191, 8192, 8193, 100000 })
+		{
+			auto data = make_test_data(size);
+			test(my_base64_decode(my_base64_encode(data)) == data);
+
+			auto encoded = my_base64_encode(data);
+			while (!encoded.empty() && encoded.back() == '=')
+				encoded.pop_back();
+			test(my_base64_decode(encoded) == data);
+		}
+	}
+	TEST_CASE(base64_encode_large)
+	{
+		auto data = make_test_data(100000);
+		std::string expected;
+		for (size_t i = 0; i + 3 <= data.size(); i += 3)
+			expected += my_base64_encode(data.substr(i, 3));
+		expected += my_base64_encode(data.substr(data.size() / 3 * 3));
+		test(my_base64_encode(data) == expected);
+
+		// Writing the data in pieces of various sizes leaves 0, 1 or 2 bytes pending between the writes
+		for (size_t piece : { 1, 2, 4, 5, 17, 100, 8191, 10000 })
+		{
+			auto s = encode_base64_to(string_writer{});
+			for (size_t i = 0; i < data.size(); i += piece)
+			{
+				auto cb = std::min(piece, data.size() - i);
+				s.write_buffer({ reinterpret_cast<const byte*>(data.data()) + i, cb });
+			}
+			test(s.flush() == expected);
+		}
+	}
+	TEST_CASE(base64_decode_large_invalid_character)
+	{
+		// An invalid character is detected wherever it is in the block
+		auto encoded = my_base64_encode(make_test_data(96));
+		for (size_t i = 0; i < encoded.size(); ++i)
+		{
+			for (char c : { '-', '_', '.', ' ', '@', '[', '`', '{', '\x80', '\xFF' })
+			{
+				auto invalid = encoded;
+				invalid[i] = c;
+				expect_exception<ill_formatted_base64_data>([&] { my_base64_decode(invalid); });
+			}
+		}
+	}
+	TEST_CASE(base64_decode_large_padding_in_middle)
+	{
+		auto encoded = my_base64_encode(make_test_data(100)) + my_base64_encode(make_test_data(100));
+		expect_exception<ill_formatted_base64_data>([&] { my_base64_decode(encoded); });
+		expect_exception<ill_formatted_base64_data>([&] { my_base64_decode("cw==" + my_base64_encode(make_test_data(100))); });
+		expect_exception<ill_formatted_base64_data>([&] { my_base64_decode("cw=A" + my_base64_encode(make_test_data(100))); });
+	}
+
 	TEST_CASE(decode_partial_buffer)
 	{
 		auto s = decode_base64(read_string("YW55IGNhcm5hbCBwbGVhc3VyZS4"));
@@ -80,6 +80,35 @@ namespace goldfish { namespace stream
 		test(stream::seek(s, 5) == 4);
 		test(stream::seek(s, 1) == 0);
 	}
+	TEST_CASE(test_buffered_reader_read_view)
+	{
+		struct reader_without_view
+		{
+			const_buffer_ref_reader m_inner;
+			size_t read_partial_buffer(buffer_ref buffer) { return m_inner.read_partial_buffer(buffer); }
+		};
+		auto to_string = [](const_buffer_ref view) { return std::string(view.begin(), view.end()); };
+
+		// The view comes from the buffer of the buffered_reader
+		auto s = buffer<3>(reader_without_view{ read_string_ref("abcdef") });
+		test(to_string(s.read_view(2)) == "ab");
+		s.consume(2);
+		test(to_string(s.read_view(10)) == "c");
+		s.consume(1);
+		test(to_string(s.read_view(10)) == "def");
+		s.consume(3);
+		test(s.read_view(10).empty());
+
+		// The view comes from the inner stream when nothing is buffered
+		auto t = buffer<3>(read_string_ref("abcdef"));
+		test(t.peek<char>() == 'a');
+		test(to_string(t.read_view(10)) == "abc");
+		t.consume(3);
+		test(to_string(t.read_view(10)) == "def");
+		t.consume(1);
+		test(stream::read<char>(t) == 'e');
+		test(read_all_as_string(t) == "f");
+	}
 	TEST_CASE(test_move_buffered_reader)
 	{
 		auto s = buffer<3>(read_string("abcdef"));
@@ -101,4 +130,28 @@ namespace goldfish { namespace stream
 
 		test(x.data() == std::vector<byte>{1, 2});
 	}
+	TEST_CASE(test_buffered_writer_reserve)
+	{
+		static_assert(!has_reserve<buffered_writer<2, vector_writer>>::value, "The buffer is too small to hold a token");
+
+		vector_writer x;
+		auto stream = buffer<max_reserve_size>(ref(x));
+		stream.write_buffer(std::vector<byte>(max_reserve_size - 2, 1));
+		auto output = stream.reserve(2);
+		output[0] = 2;
+		output[1] = 3;
+		stream.commit(2);
+		test(x.data().empty());
+
+		// Doesn't fit in what is left of the buffer
+		output = stream.reserve(3);
+		test(x.data().size() == max_reserve_size);
+		output[0] = 4;
+		stream.commit(1);
+		stream.flush();
+
+		auto expected = std::vector<byte>(max_reserve_size - 2, 1);
+		expected.insert(expected.end(), { 2, 3, 4 });
+		test(x.data() == expected);
+	}
 }}
\ No newline at end of file
@@ -25,12 +25,24 @@ namespace goldfish { namespace dom
 		}
 		return data;
 	}
+	// Hides read_view, so that documents are decoded through the jump table rather than from views of the data
+	struct ref_reader_without_view
+	{
+		stream::const_buffer_ref_reader& m_inner;
+		size_t read_partial_buffer(buffer_ref buffer) { return m_inner.read_partial_buffer(buffer); }
+		uint64_t seek(uint64_t x) { return m_inner.seek(x); }
+	};
 	static auto r(std::string input)
 	{
 		auto binary = to_vector(input);
 		stream::const_buffer_ref_reader s(binary);
 		auto result = load_in_memory(cbor::read(stream::ref(s)));
 		test(seek(s, 1) == 0);
+
+		stream::const_buffer_ref_reader t(binary);
+		auto without_view = load_in_memory(cbor::read(ref_reader_without_view{ t }));
+		test(without_view == result || (result.is<double>() && isnan(result.as<double>()) && isnan(without_view.as<double>())));
+		test(seek(t, 1) == 0);
 		return result;
 	};
 
@@ -150,6 +162,17 @@ namespace goldfish { namespace dom
 		test(r("bf6346756ef563416d7421ff") == map{ { "Fun", true }, { "Amt", -2ll } });
 	}
 
+	TEST_CASE(read_truncated_header)
+	{
+		for (auto input : { "", "18", "1903", "1a000f42", "1b000000e8d4a510", "5a0000", "fb3ff000" })
+		{
+			auto binary = to_vector(input);
+			expect_exception<stream::unexpected_end_of_stream>([&] { cbor::read(stream::read_buffer_ref(binary)); });
+			stream::const_buffer_ref_reader s(binary);
+			expect_exception<stream::unexpected_end_of_stream>([&] { cbor::read(ref_reader_without_view{ s }); });
+		}
+	}
+
 	TEST_CASE(seek_in_finite_string)
 	{
 		auto binary = to_vector("6449455446"); // IETF
@@ -195,4 +218,27 @@ namespace goldfish { namespace dom
 		stream::const_buffer_ref_reader s(binary);
 		test(stream::seek(cbor::read(stream::ref(s)).as_string(), 10) == 9);
 	}
+
+	TEST_CASE(read_view_in_chunked_string)
+	{
+		auto binary = to_vector("7f657374726561646d696e67ff"); // "strea" "ming"
+		stream::const_buffer_ref_reader s(binary);
+		auto result = cbor::read(stream::ref(s)).as_string();
+		auto to_string = [](const_buffer_ref view) { return std::string(view.begin(), view.end()); };
+
+		test(to_string(result.read_view(3)) == "str");
+		result.consume(3);
+		test(to_string(result.read_view(10)) == "ea"); // views don't span blocks
+		result.consume(2);
+		test(to_string(result.read_view(10)) == "ming");
+		result.consume(4);
+		test(result.read_view(10).empty());
+		test(stream::seek(s, 1) == 0);
+	}
+
+	TEST_CASE(copy_chunked_string)
+	{
+		auto binary = to_vector("7f657374726561646d696e67ff"); // "strea" "ming"
+		test(stream::read_all_as_string(cbor::read(stream::read_buffer_ref(binary)).as_string()) == "streaming");
+	}
 }}
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "dom.h"
 #include <goldfish/cbor_writer.h>
+#include <goldfish/json_reader.h>
 #include <goldfish/stream.h>
 #include "unit_test.h"
 
@@ -108,6 +109,18 @@ namespace goldfish { namespace dom
 		}) == "a56161614161626142616361436164614461656145");
 	}
 
+	TEST_CASE(write_raw_numbers)
+	{
+		// CBOR has no representation for numbers kept as text: they are converted when written
+		auto w = [&](auto&& d)
+		{
+			return to_hex_string(cbor::create_writer(stream::vector_writer{}).write(d));
+		};
+		auto data = "[0,1,-1,1.5,100000000000,-100000000000,1e2]";
+		test(w(json::read_raw_numbers(stream::read_string_ref(data))) == w(json::read(stream::read_string_ref(data))));
+		expect_exception<json::integer_overflow_in_json>([&] { w(json::read_raw_numbers(stream::read_string_ref("[18446744073709551616]"))); });
+	}
+
 	TEST_CASE(write_infinite_array)
 	{
 		auto w = [&](const std::vector<document>& data)
@@ -147,6 +160,20 @@ namespace goldfish { namespace dom
 		}) == "bf6346756ef563416d7421ff");
 	}
 
+	TEST_CASE(write_constant_keys)
+	{
+		static constexpr auto fun = make_key("Fun");
+		static constexpr auto long_key = make_key("a key longer than 23 bytes");
+
+		stream::vector_writer s;
+		auto map = cbor::create_writer(stream::ref(s)).start_map(3);
+		map.write(fun, true);
+		map.write(long_key, 1ull);
+		map.write(make_key(""), fun);
+		map.flush();
+		test(to_hex_string(s.flush()) == "a36346756ef5781a61206b6579206c6f6e676572207468616e20323320627974657301606346756e");
+	}
+
 	TEST_CASE(write_infinite_string)
 	{
 		auto w = [&](const std::vector<std::string>& data)
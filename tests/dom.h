@@ -98,6 +98,7 @@ namespace goldfish { namespace dom
 				}
 				return result;
 			},
+			[](auto&& x, tags::number) -> document { return x.value().visit([](auto value) -> document { return value; }); },
 			[](auto&& x, auto) -> document { return std::forward<decltype(x)>(x); }
 		));
 	}
@@ -1,5 +1,162 @@
 #include <goldfish/file_stream.h>
+#include <goldfish/buffered_stream.h>
+#include <goldfish/cbor_reader.h>
+#include <goldfish/cbor_writer.h>
+#include <goldfish/stream.h>
+
+#include "dom.h"
+#include "unit_test.h"
 
 namespace goldfish { namespace stream
 {
-}}
\ No newline at end of file
+	static_assert(is_reader<file_reader>::value, "file_reader is a reader");
+	static_assert(is_writer<file_writer>::value, "file_writer is a writer");
+
+	TEST_CASE(test_file_reader_writer)
+	{
+		{
+			file_writer writer("file_stream_test.bin");
+			writer.write_buffer(string_literal_to_non_null_terminated_buffer("Hello world"));
+			writer.flush();
+		}
+		test(read_all_as_string(file_reader("file_stream_test.bin")) == "Hello world");
+		remove("file_stream_test.bin");
+	}
+	static_assert(has_seek<file_reader>::value, "file_reader can seek");
+
+	static void write_numbers_file(const char* path, size_t count)
+	{
+		file_writer writer(path);
+		for (size_t i = 0; i < count; ++i)
+			stream::write(writer, static_cast<uint32_t>(i));
+		writer.flush();
+	}
+	TEST_CASE(test_file_reader_seek)
+	{
+		write_numbers_file("file_stream_test_seek.bin", 100000);
+		{
+			file_reader reader("file_stream_test_seek.bin");
+			test(stream::read<uint32_t>(reader) == 0);
+			test(reader.seek(4) == 4);
+			test(stream::read<uint32_t>(reader) == 2);
+			test(reader.seek(4 * 50000) == 4 * 50000);
+			test(stream::read<uint32_t>(reader) == 50003);
+			test(reader.seek(1000000) == 4 * (100000 - 50004));
+			test(reader.seek(1) == 0);
+			test(read_all(reader).empty());
+		}
+		{
+			// buffered_reader forwards the part of the seek that isn't in its buffer
+			auto reader = buffer<64>(file_reader("file_stream_test_seek.bin"));
+			test(stream::read<uint32_t>(reader) == 0);
+			test(stream::seek(reader, 4 * 70000) == 4 * 70000);
+			test(stream::read<uint32_t>(reader) == 70001);
+			test(stream::read<uint32_t>(reader) == 70002);
+		}
+		remove("file_stream_test_seek.bin");
+	}
+	TEST_CASE(test_file_reader_seek_cbor_binary)
+	{
+		{
+			auto writer = cbor::create_writer(file_writer("file_stream_test_cbor.bin")).start_array();
+			std::vector<byte> large(10 * 1024 * 1024, 1);
+			writer.write(const_buffer_ref{ large.data(), large.size() });
+			writer.write(42ull);
+			writer.flush();
+		}
+		auto document = cbor::read(buffer<8192>(file_reader("file_stream_test_cbor.bin"))).as_array();
+		seek_to_end(document.read()->as_binary());
+		test(dom::load_in_memory(*document.read()) == 42ull);
+		test(document.read() == nullopt);
+		remove("file_stream_test_cbor.bin");
+	}
+	TEST_CASE(test_file_reader_file_not_found)
+	{
+		expect_exception<io_exception>([] { file_reader("this_file_does_not_exist.bin"); });
+	}
+
+	#ifndef _WIN32
+	static_assert(is_reader<fd_reader>::value, "fd_reader is a reader");
+	static_assert(is_writer<fd_writer>::value, "fd_writer is a writer");
+
+	TEST_CASE(test_fd_reader_writer)
+	{
+		{
+			fd_writer writer("fd_stream_test.bin");
+			writer.write_buffer(string_literal_to_non_null_terminated_buffer("Hello world"));
+			writer.flush();
+		}
+		test(read_all_as_string(fd_reader("fd_stream_test.bin")) == "Hello world");
+		remove("fd_stream_test.bin");
+	}
+	TEST_CASE(test_fd_reader_writer_large)
+	{
+		// Mix of writes smaller and larger than the internal buffer
+		std::string expected;
+		{
+			fd_writer writer("fd_stream_test_large.bin");
+			for (size_t size : { size_t(1), size_t(1000), fd_buffer_length - 1, fd_buffer_length, size_t(3), 3 * fd_buffer_length })
+			{
+				std::string chunk(size, static_cast<char>('a' + size % 26));
+				writer.write_buffer({ reinterpret_cast<const byte*>(chunk.data()), chunk.size() });
+				expected += chunk;
+			}
+			auto moved = std::move(writer);
+			moved.flush();
+		}
+
+		fd_reader reader("fd_stream_test_large.bin");
+		std::string actual;
+		for (size_t size : { size_t(1), size_t(10), 2 * fd_buffer_length, size_t(7) })
+		{
+			std::string chunk(size, '\0');
+			chunk.resize(read_full_buffer(reader, { reinterpret_cast<byte*>(&chunk[0]), chunk.size() }));
+			actual += chunk;
+		}
+		actual += read_all_as_string(reader);
+		test(actual == expected);
+		remove("fd_stream_test_large.bin");
+	}
+	TEST_CASE(test_fd_writer_flushes_on_destruction)
+	{
+		{
+			fd_writer writer(std::string("fd_stream_test_destruction.bin"));
+			writer.write_buffer(string_literal_to_non_null_terminated_buffer("abc"));
+		}
+		test(read_all_as_string(fd_reader("fd_stream_test_destruction.bin")) == "abc");
+		remove("fd_stream_test_destruction.bin");
+	}
+	static_assert(has_seek<fd_reader>::value, "fd_reader can seek");
+
+	TEST_CASE(test_fd_reader_seek)
+	{
+		write_numbers_file("fd_stream_test_seek.bin", 100000);
+		fd_reader reader("fd_stream_test_seek.bin");
+		test(stream::read<uint32_t>(reader) == 0);
+		test(reader.seek(4) == 4); // in the internal buffer
+		test(stream::read<uint32_t>(reader) == 2);
+		test(reader.seek(4 * 50000) == 4 * 50000); // past the internal buffer
+		test(stream::read<uint32_t>(reader) == 50003);
+		test(reader.seek(1000000) == 4 * (100000 - 50004));
+		test(read_all(reader).empty());
+		remove("fd_stream_test_seek.bin");
+	}
+	TEST_CASE(test_fd_reader_seek_pipe)
+	{
+		// Pipes can't be seeked, the data is read instead
+		int fds[2];
+		test(pipe(fds) == 0);
+		{
+			fd_writer writer(fds[1], fd_ownership::owned);
+			writer.write_buffer(string_literal_to_non_null_terminated_buffer("Hello world"));
+		}
+		fd_reader reader(fds[0], fd_ownership::owned);
+		test(reader.seek(6) == 6);
+		test(read_all_as_string(reader) == "world");
+	}
+	TEST_CASE(test_fd_reader_file_not_found)
+	{
+		expect_exception<io_exception>([] { fd_reader("this_file_does_not_exist.bin"); });
+	}
+	#endif
+}}
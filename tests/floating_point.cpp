@@ -0,0 +1,141 @@
+#include <goldfish/floating_point.h>
+#include <goldfish/json_reader.h>
+
+#include "unit_test.h"
+
+namespace goldfish { namespace floating_point
+{
+	static double parse(const std::string& text)
+	{
+		return json::read(stream::read_string_ref(text)).as_double();
+	}
+	static uint64_t bits(double x)
+	{
+		uint64_t result;
+		memcpy(&result, &x, sizeof(result));
+		return result;
+	}
+
+	TEST_CASE(parse_double_correctly_rounded)
+	{
+		test(parse("0.1") == 0.1);
+		test(parse("0.3") == 0.3);
+		test(parse("1.1") == 1.1);
+		test(parse("123456789.123456789") == 123456789.123456789);
+		test(parse("9007199254740993") == 9007199254740993.); // integers are read exactly
+		test(parse("9007199254740993.0") == 9007199254740992.); // ties to even
+		test(parse("9007199254740995.0") == 9007199254740996.);
+		test(parse("1.7976931348623157e308") == 1.7976931348623157e308);
+		test(parse("1.7976931348623159e308") == std::numeric_limits<double>::infinity());
+		test(parse("2.2250738585072011e-308") == 2.2250738585072011e-308);
+		test(parse("2.2250738585072012e-308") == 2.2250738585072012e-308);
+		test(parse("4.9406564584124654e-324") == std::numeric_limits<double>::denorm_min());
+		test(parse("2.4703282292062328e-324") == std::numeric_limits<double>::denorm_min());
+		test(parse("2.4703282292062327e-324") == 0.);
+		test(parse("1e-400") == 0.);
+		test(bits(parse("-1e-400")) == bits(-0.));
+		test(parse("1e400") == std::numeric_limits<double>::infinity());
+		test(parse("1e99999999999999999999") == std::numeric_limits<double>::infinity());
+		test(parse("0e99999999999999999999") == 0.);
+		test(parse("0.000000000000000000000000000001") == 1e-30);
+		test(parse("123456789012345678901234567890.0") == 123456789012345678901234567890.);
+		test(parse("-123456789012345678901234567890.5e-10") == -123456789012345678901234567890.5e-10);
+	}
+
+	TEST_CASE(parse_double_with_many_digits)
+	{
+		// Exact value of the double closest to 0.1
+		test(parse("0.1000000000000000055511151231257827021181583404541015625") == 0.1);
+
+		// Half way between 2^53 and 2^53 + 2: the digits after the first 768 decide
+		auto halfway = "9007199254740993." + std::string(1000, '0');
+		test(parse(halfway) == 9007199254740992.);
+		test(parse(halfway + "1") == 9007199254740994.);
+		test(parse("-" + halfway + "1") == -9007199254740994.);
+		test(parse("0.00" + std::string(1000, '9')) == 0.01);
+	}
+
+	TEST_CASE(parse_eight_digits)
+	{
+		auto count = [](const char* text) { return details::count_leading_digits(details::load_eight_characters(text)); };
+		test(count("12345678") == 8);
+		test(count("00000000") == 8);
+		test(count("99999999") == 8);
+		test(count("1234567.") == 7);
+		test(count("/2345678") == 0);
+		test(count("1234:678") == 4);
+		test(count("1e\xFF\xFF\xFF\xFF\xFF\xFF") == 1);
+		test(count("1,\xFA" "5678") == 1);
+
+		auto parse = [](const char* text, unsigned count) { return details::parse_digits(details::load_eight_characters(text), count); };
+		test(parse("12345678", 8) == 12345678);
+		test(parse("00000000", 8) == 0);
+		test(parse("99999999", 8) == 99999999);
+		test(parse("00000042", 8) == 42);
+		test(parse("1234567.", 7) == 1234567);
+		test(parse("42,12345", 2) == 42);
+		test(parse("9]......", 1) == 9);
+	}
+
+	TEST_CASE(parse_double_round_trip)
+	{
+		uint64_t seed = 42;
+		for (int i = 0; i < 100000; ++i)
+		{
+			seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+			double expected;
+			memcpy(&expected, &seed, sizeof(expected));
+			if (expected != expected || expected == std::numeric_limits<double>::infinity() || expected == -std::numeric_limits<double>::infinity())
+				continue;
+
+			char text[64];
+			snprintf(text, sizeof(text), "%.17g", expected);
+			test(bits(parse(text)) == bits(expected));
+
+			// More digits than fit in 64 bits
+			snprintf(text, sizeof(text), "%.40e", expected);
+			test(bits(parse(text)) == bits(expected));
+		}
+	}
+
+	TEST_CASE(shortest_decimal)
+	{
+		auto shortest = [](double x) { auto result = to_shortest_decimal(x); return std::to_string(result.digits) + "e" + std::to_string(result.exponent); };
+		test(shortest(0.) == "0e0");
+		test(shortest(1.) == "1e0");
+		test(shortest(1000.) == "1e3");
+		test(shortest(0.1) == "1e-1");
+		test(shortest(0.3) == "3e-1");
+		test(shortest(0.1 + 0.2) == "30000000000000004e-17");
+		test(shortest(123456789.123456789) == "12345678912345679e-8");
+		test(shortest(9007199254740992.) == "9007199254740992e0");
+		test(shortest(1e23) == "1e23");
+		test(shortest(5e-324) == "5e-324");
+		test(shortest(std::numeric_limits<double>::min()) == "22250738585072014e-324");
+		test(shortest(std::numeric_limits<double>::max()) == "17976931348623157e292");
+		test(shortest(4.0) == "4e0"); // the previous double is closer than the next one
+		test(shortest(2.9802322387695312e-8) == "29802322387695312e-24");
+
+		uint64_t seed = 42;
+		for (int i = 0; i < 100000; ++i)
+		{
+			seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+			double x;
+			auto positive = seed & 0x7FFFFFFFFFFFFFFFull;
+			memcpy(&x, &positive, sizeof(x));
+			if (x != x || x == std::numeric_limits<double>::infinity())
+				continue;
+
+			// Reads back as x, and one digit less doesn't
+			auto result = to_shortest_decimal(x);
+			test(bits(parse(std::to_string(result.digits) + "e" + std::to_string(result.exponent))) == bits(x));
+			auto digits = std::to_string(result.digits).size();
+			if (digits > 1)
+			{
+				char text[64];
+				snprintf(text, sizeof(text), "%.*e", static_cast<int>(digits) - 2, x);
+				test(bits(parse(text)) != bits(x));
+			}
+		}
+	}
+}}
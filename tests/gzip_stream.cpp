@@ -0,0 +1,81 @@
+// Not part of tests.vcxproj since it requires zlib, see README.md to build it
+#include <goldfish/gzip_stream.h>
+#include <goldfish/buffered_stream.h>
+#include <goldfish/json_reader.h>
+#include "unit_test.h"
+
+namespace goldfish { namespace stream
+{
+	static std::vector<byte> gzip_compress(const std::string& data, int compression_level = Z_DEFAULT_COMPRESSION)
+	{
+		auto s = compress_gzip_to(vector_writer{}, compression_level);
+		s.write_buffer({ reinterpret_cast<const byte*>(data.data()), data.size() });
+		return s.flush();
+	}
+
+	TEST_CASE(gzip_round_trip)
+	{
+		for (size_t size : { 0, 1, 100, 100000, 1000000 })
+		{
+			auto data = make_test_data(size);
+			auto compressed = gzip_compress(data);
+			test(read_all_as_string(decompress_gzip(read_buffer_ref(compressed))) == data);
+		}
+	}
+	TEST_CASE(gzip_compression_level)
+	{
+		auto data = make_test_data(100000);
+		auto fast = gzip_compress(data, 1);
+		auto best = gzip_compress(data, 9);
+		test(best.size() < fast.size());
+		test(fast.size() < data.size());
+		test(read_all_as_string(decompress_gzip(read_buffer_ref(fast))) == data);
+		test(read_all_as_string(decompress_gzip(read_buffer_ref(best))) == data);
+	}
+	TEST_CASE(gzip_read_small_pieces)
+	{
+		auto data = make_test_data(10000);
+		auto compressed = gzip_compress(data);
+		auto s = decompress_gzip(read_buffer_ref(compressed));
+
+		std::string result;
+		byte buffer[7];
+		while (auto cb = s.read_partial_buffer(buffer))
+			result.append(reinterpret_cast<const char*>(buffer), cb);
+		test(result == data);
+	}
+	TEST_CASE(gzip_concatenated_members)
+	{
+		auto compressed = gzip_compress("Hello ");
+		auto second = gzip_compress("world");
+		compressed.insert(compressed.end(), second.begin(), second.end());
+		test(read_all_as_string(decompress_gzip(read_buffer_ref(compressed))) == "Hello world");
+	}
+	TEST_CASE(gzip_invalid_data)
+	{
+		expect_exception<ill_formatted_gzip_data>([] { read_all(decompress_gzip(read_string("not compressed data"))); });
+
+		auto compressed = gzip_compress(make_test_data(1000));
+		compressed[compressed.size() / 2] ^= 0xFF;
+		expect_exception<ill_formatted_gzip_data>([&] { read_all(decompress_gzip(read_buffer_ref(compressed))); });
+	}
+	TEST_CASE(gzip_truncated_data)
+	{
+		auto compressed = gzip_compress(make_test_data(1000));
+		compressed.resize(compressed.size() - 1);
+		expect_exception<ill_formatted_gzip_data>([&] { read_all(decompress_gzip(read_buffer_ref(compressed))); });
+	}
+	TEST_CASE(gzip_json_document)
+	{
+		std::string json = "[0";
+		for (uint64_t i = 1; i < 1000; ++i)
+			json += "," + std::to_string(i);
+		json += "]";
+		auto compressed = gzip_compress(json);
+
+		auto document = json::read(buffer<8192>(decompress_gzip(read_buffer_ref(compressed)))).as_array();
+		for (uint64_t i = 0; i < 1000; ++i)
+			test(document.read()->as_uint64() == i);
+		test(document.read() == nullopt);
+	}
+}}
@@ -0,0 +1,96 @@
+#include <goldfish/instrumentation.h>
+#include <goldfish/buffered_stream.h>
+#include <goldfish/cbor_reader.h>
+#include <goldfish/json_reader.h>
+#include "dom.h"
+
+#include "unit_test.h"
+
+namespace goldfish { namespace instrumentation
+{
+	static_assert(std::is_same<policy_of_t<stream::const_buffer_ref_reader>, none>::value, "Streams use the default policy");
+	static_assert(std::is_same<policy_of_t<stream::buffered_reader<8, stream::const_buffer_ref_reader, count_events>>, count_events>::value, "");
+	static_assert(std::is_same<policy_of_t<stream::ref_reader<stream::buffered_reader<8, stream::const_buffer_ref_reader, count_events>>>, count_events>::value, "ref_reader forwards the policy");
+
+	// Reader without read_view, so that buffered_reader has to copy the data in its buffer
+	struct string_reader_without_view
+	{
+		size_t read_partial_buffer(buffer_ref data)
+		{
+			auto cb = std::min(data.size(), m_data.size() - m_offset);
+			std::copy(m_data.begin() + m_offset, m_data.begin() + m_offset + cb, data.begin());
+			m_offset += cb;
+			return cb;
+		}
+		std::string m_data;
+		size_t m_offset = 0;
+	};
+
+	TEST_CASE(instrumentation_count_json_documents)
+	{
+		auto& c = count_events::get();
+		c.reset();
+		dom::load_in_memory(json::read(stream::buffer<8, count_events>(stream::read_string("[1,-2,\"abc\",{\"x\":null,\"y\":true},3.5]"))));
+		test(c[event::array_document] == 1);
+		test(c[event::unsigned_int_document] == 1);
+		test(c[event::signed_int_document] == 1);
+		test(c[event::string_document] == 3);
+		test(c[event::map_document] == 1);
+		test(c[event::null_document] == 1);
+		test(c[event::boolean_document] == 1);
+		test(c[event::floating_point_document] == 1);
+		test(c[event::binary_document] == 0);
+	}
+	TEST_CASE(instrumentation_count_cbor_documents)
+	{
+		auto& c = count_events::get();
+		c.reset();
+		// [1, h'01', undefined]
+		dom::load_in_memory(cbor::read(stream::buffer<8, count_events>(stream::read_buffer_ref(std::vector<byte>{ 0x83, 0x01, 0x41, 0x01, 0xf7 }))));
+		test(c[event::array_document] == 1);
+		test(c[event::unsigned_int_document] == 1);
+		test(c[event::binary_document] == 1);
+		test(c[event::undefined_document] == 1);
+		test(c[event::string_document] == 0);
+	}
+	TEST_CASE(instrumentation_count_reads)
+	{
+		auto& c = count_events::get();
+		c.reset();
+		auto s = stream::buffer<4, count_events>(string_reader_without_view{ "abcdefghij" });
+		test(stream::read<char>(s) == 'a');
+		test(c[event::buffer_refills] == 1);
+		test(c[event::bytes_read] == 4);
+
+		// Peeking 3 bytes when only 3 are buffered doesn't need a refill
+		test(s.peek<std::array<char, 3>>() == std::array<char, 3>{ 'b', 'c', 'd' });
+		test(c[event::buffer_refills] == 1);
+		test(c[event::buffer_memmove_bytes] == 0);
+
+		test(stream::read<char>(s) == 'b');
+		test(s.peek<std::array<char, 3>>() == std::array<char, 3>{ 'c', 'd', 'e' });
+		test(c[event::buffer_memmove_bytes] == 2);
+		test(c[event::buffer_refills] == 2);
+		test(c[event::bytes_read] == 6);
+
+		// 4 bytes are skipped in the buffer, 2 in the inner stream
+		test(stream::seek(s, 6) == 6);
+		test(c[event::bytes_skipped] == 2);
+		test(stream::read_all_as_string(s) == "ij");
+	}
+	TEST_CASE(instrumentation_count_writes)
+	{
+		auto& c = count_events::get();
+		c.reset();
+		stream::vector_writer x;
+		auto s = stream::buffer<4, count_events>(stream::ref(x));
+		s.write_buffer(const_buffer_ref{ reinterpret_cast<const byte*>("ab"), 2 });
+		test(c[event::writer_flushes] == 0);
+		s.write_buffer(const_buffer_ref{ reinterpret_cast<const byte*>("cdef"), 4 });
+		s.write_buffer(const_buffer_ref{ reinterpret_cast<const byte*>("0123456789"), 10 });
+		s.flush();
+		test(x.data().size() == 16);
+		test(c[event::bytes_written] == 16);
+		test(c[event::writer_flushes] >= 2);
+	}
+}}
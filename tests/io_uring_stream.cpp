@@ -0,0 +1,83 @@
+#include <goldfish/io_uring_stream.h>
+#include <goldfish/buffered_stream.h>
+#include <goldfish/json_reader.h>
+#include <goldfish/json_writer.h>
+
+#include "unit_test.h"
+
+#ifdef __linux__
+namespace goldfish { namespace stream
+{
+	static_assert(is_reader<io_uring_reader>::value, "io_uring_reader is a reader");
+	static_assert(is_writer<io_uring_writer>::value, "io_uring_writer is a writer");
+	static_assert(has_read_view<io_uring_reader>::value, "io_uring_reader exposes its buffers");
+
+	TEST_CASE(test_io_uring_reader_writer)
+	{
+		auto t = [](size_t size, unsigned queue_depth, size_t chunk_size)
+		{
+			std::string data;
+			for (size_t i = 0; i < size; ++i)
+				data.push_back(static_cast<char>('a' + i % 26));
+			{
+				io_uring_writer writer("io_uring_stream_test.bin", queue_depth, chunk_size);
+				for (size_t i = 0; i < data.size(); i += 1000)
+					writer.write_buffer({ reinterpret_cast<const byte*>(data.data()) + i, std::min<size_t>(1000, data.size() - i) });
+				writer.flush();
+			}
+			test(read_all_as_string(io_uring_reader("io_uring_stream_test.bin", queue_depth, chunk_size)) == data);
+			remove("io_uring_stream_test.bin");
+		};
+		t(0, 1, 4096);
+		t(1, 1, 4096);
+		t(4096, 2, 4096);
+		t(100000, 1, 4096);
+		t(100000, 4, 4096);
+		t(1000000, 8, 64 * 1024);
+	}
+	TEST_CASE(test_io_uring_writer_flushes_on_destruction)
+	{
+		{
+			io_uring_writer writer(std::string("io_uring_stream_test_destruction.bin"));
+			writer.write_buffer(string_literal_to_non_null_terminated_buffer("abc"));
+		}
+		test(read_all_as_string(io_uring_reader("io_uring_stream_test_destruction.bin")) == "abc");
+		remove("io_uring_stream_test_destruction.bin");
+	}
+	TEST_CASE(test_io_uring_reader_stopped_before_end)
+	{
+		{
+			io_uring_writer writer("io_uring_stream_test_partial.bin", 2, 4096);
+			std::string data(100000, 'a');
+			writer.write_buffer({ reinterpret_cast<const byte*>(data.data()), data.size() });
+			writer.flush();
+		}
+		{
+			// The reads still in flight are waited for before the buffers are freed
+			io_uring_reader reader("io_uring_stream_test_partial.bin", 4, 4096);
+			test(stream::read<char>(reader) == 'a');
+			test(stream::seek(reader, 50000) == 50000);
+		}
+		remove("io_uring_stream_test_partial.bin");
+	}
+	TEST_CASE(test_io_uring_json)
+	{
+		// The streams are moved into the buffered reader and into the JSON reader and writer
+		{
+			auto writer = json::create_writer(io_uring_writer("io_uring_stream_test.json", 2, 4096)).start_array();
+			for (uint64_t i = 0; i < 10000; ++i)
+				writer.write(i);
+			writer.flush();
+		}
+		auto document = json::read(buffer<8192>(io_uring_reader("io_uring_stream_test.json", 2, 4096))).as_array();
+		for (uint64_t i = 0; i < 10000; ++i)
+			test(document.read()->as_uint64() == i);
+		test(document.read() == nullopt);
+		remove("io_uring_stream_test.json");
+	}
+	TEST_CASE(test_io_uring_reader_file_not_found)
+	{
+		expect_exception<io_exception>([] { io_uring_reader("this_file_does_not_exist.bin"); });
+	}
+}}
+#endif
@@ -68,7 +68,9 @@ namespace goldfish { namespace dom
 		test(r("2.2204460492503131e-016") == 2.2204460492503131e-016);
 		test(r("2.2250738585072014e-308") == 2.2250738585072014e-308);
 		test(r("1e309") == std::numeric_limits<double>::infinity());
-		test(r("1e-309") == 0.);
+		test(r("1e-309") == 1e-309); // subnormal
+		test(r("1e-400") == 0.);
+		test(r("123456789012345678901234567890.5") == 123456789012345678901234567890.5);
 
 		expect_exception<json::ill_formatted_json_data>([&] { r("0."); });
 		expect_exception<json::ill_formatted_json_data>([&] { r("[0.]"); });
@@ -120,6 +122,202 @@ namespace goldfish { namespace dom
 		test(r("\"\\uD801\\uDC37\"") == u8"\U00010437");
 	}
 
+	struct reader_without_view
+	{
+		stream::const_buffer_ref_reader m_inner;
+		size_t read_partial_buffer(buffer_ref buffer) { return m_inner.read_partial_buffer(buffer); }
+		template <class T> auto read() { return stream::read<T>(m_inner); }
+		template <class T> auto peek() { return m_inner.peek<T>(); }
+	};
+	TEST_CASE(json_read_string_without_read_view)
+	{
+		auto r = [](auto input)
+		{
+			return stream::read_all_as_string(json::read(reader_without_view{ stream::read_string_ref(input) }).as_string());
+		};
+		test(r("\"abc\"") == "abc");
+		test(r("\"a\\u0001\\b\\n\\r\\t\\\"\\/\"") == u8"a\u0001\b\n\r\t\"/");
+		expect_exception<stream::unexpected_end_of_stream>([&] { r("\"abc"); });
+	}
+
+	TEST_CASE(json_read_numbers_in_blocks)
+	{
+		// Numbers are parsed 8 digits at a time when the stream has a read_view: the result shouldn't depend on how the digits are split across views
+		auto in_memory = [](const std::string& input) { return load_in_memory(json::read(stream::read_string_ref(input.c_str()))); };
+		auto without_view = [](const std::string& input) { return load_in_memory(json::read(reader_without_view{ stream::read_string_ref(input.c_str()) })); };
+		auto small_views = [](const std::string& input) { return load_in_memory(json::read(stream::buffer<5>(reader_without_view{ stream::read_string_ref(input.c_str()) }))); };
+		auto r = [&](const std::string& input)
+		{
+			auto result = in_memory(input);
+			test(without_view(input) == result);
+			test(small_views(input) == result);
+			return result;
+		};
+
+		std::string digits = "12345678901234567890";
+		for (size_t i = 1; i <= 19; ++i)
+		{
+			test(r(digits.substr(0, i)) == std::stoull(digits.substr(0, i)));
+			test(r("-" + digits.substr(0, i)) == -static_cast<int64_t>(std::stoll(digits.substr(0, i))));
+			test(r("[" + digits.substr(0, i) + "]") == array{ std::stoull(digits.substr(0, i)) });
+			test(r(digits.substr(0, i) + "." + digits) == std::stod(digits.substr(0, i) + "." + digits));
+			test(r("0." + digits.substr(0, i) + "e-3") == std::stod("0." + digits.substr(0, i) + "e-3"));
+		}
+		test(r("18446744073709551615") == 18446744073709551615ull);
+		test(r("[99999999999999999999.99999999]") == array{ 99999999999999999999.99999999 });
+		expect_exception<json::integer_overflow_in_json>([&] { in_memory("18446744073709551616"); });
+		expect_exception<json::integer_overflow_in_json>([&] { in_memory("123456781234567812345678"); });
+		expect_exception<json::integer_overflow_in_json>([&] { small_views("123456781234567812345678"); });
+		expect_exception<json::ill_formatted_json_data>([&] { in_memory("[0123456789]"); });
+		expect_exception<json::ill_formatted_json_data>([&] { small_views("1.a2345678"); });
+	}
+
+	TEST_CASE(json_read_tokens_across_views)
+	{
+		// Whitespace, literals and numbers are parsed in place in the view of the stream: the result shouldn't depend on where the views end
+		auto in_memory = [](const std::string& input) { return load_in_memory(json::read(stream::read_string_ref(input.c_str()))); };
+		auto without_view = [](const std::string& input) { return load_in_memory(json::read(reader_without_view{ stream::read_string_ref(input.c_str()) })); };
+		auto small_views = [](const std::string& input) { return load_in_memory(json::read(stream::buffer<3>(reader_without_view{ stream::read_string_ref(input.c_str()) }))); };
+		auto r = [&](const std::string& input)
+		{
+			auto result = in_memory(input);
+			test(without_view(input) == result);
+			test(small_views(input) == result);
+			return result;
+		};
+
+		test(r("  \r\n\t true") == true);
+		test(r("false  ") == false);
+		test(r("\n\nnull\n") == nullptr);
+		test(r("[ true ,\tfalse,null , 12 ,-3.5e1 ]") == array{ true, false, nullptr, 12ull, -35.0 });
+		test(r("{ \"a\" :\n1 ,  \"b\":[ null ] }") == map{ { "a", 1ull }, { "b", array{ nullptr } } });
+		test(r("[0,-0,1234567890123456789,12345678901234567890,-9223372036854775808]") == array{ 0ull, 0ll, 1234567890123456789ull, 12345678901234567890ull, std::numeric_limits<int64_t>::min() });
+		test(r("[0.5,-12.25e-1,1E2,123456789.123456789]") == array{ 0.5, -1.225, 100.0, 123456789.123456789 });
+		for (auto input : { "tru", "fals", "[nul", "[ 1 ,", "  " })
+		{
+			expect_exception<stream::unexpected_end_of_stream>([&] { in_memory(input); });
+			expect_exception<stream::unexpected_end_of_stream>([&] { small_views(input); });
+		}
+		for (auto input : { "trUe", "[falsy]", "nil", "[1 2]", "[01]", "[-]", "[1.]", "[1e+]" })
+		{
+			expect_exception<json::ill_formatted_json_data>([&] { in_memory(input); });
+			expect_exception<json::ill_formatted_json_data>([&] { small_views(input); });
+		}
+		for (auto input : { "[-9223372036854775809]", "[-9999999999999999999]", "[18446744073709551616]", "[1,-18446744073709551615]" })
+		{
+			expect_exception<json::integer_overflow_in_json>([&] { in_memory(input); });
+			expect_exception<json::integer_overflow_in_json>([&] { without_view(input); });
+			expect_exception<json::integer_overflow_in_json>([&] { small_views(input); });
+		}
+	}
+
+	TEST_CASE(json_read_raw_numbers)
+	{
+		auto text = [](const std::string& input)
+		{
+			auto d = json::read_raw_numbers(stream::read_string_ref(input.c_str()));
+			test(d.is_exactly<tags::number>());
+			return d.visit(first_match(
+				[](auto&& x, tags::number) { auto t = x.text(); return std::string(t.begin(), t.end()); },
+				[](auto&&, auto) -> std::string { throw bad_variant_access{}; }));
+		};
+		test(text("0") == "0");
+		test(text("-0") == "-0");
+		test(text("123 ") == "123");
+		test(text("-1.50e+10,") == "-1.50e+10");
+		test(text("1E-7]") == "1E-7");
+		test(text("1234567890.1234567890123456789012345678901234567890") == "1234567890.1234567890123456789012345678901234567890");
+		test(text("123456789012345678901234567890") == "123456789012345678901234567890");
+
+		// The conversion happens when the value is requested
+		auto r = [](const char* input) { return json::read_raw_numbers(stream::read_string_ref(input)); };
+		test(r("42").as_uint64() == 42);
+		test(r("-42").as_int64() == -42);
+		test(r("42").as_int64() == 42);
+		test(r("0.1").as_double() == 0.1);
+		test(r("1e2").as_uint64() == 100);
+		test(r("18446744073709551615").as_uint64() == 18446744073709551615ull);
+		test(r("18446744073709551616.0").as_double() == 18446744073709551616.);
+		expect_exception<json::integer_overflow_in_json>([&] { r("18446744073709551616").as_uint64(); });
+		expect_exception<integer_overflow_while_casting>([&] { r("-1").as_uint64(); });
+		expect_exception<integer_overflow_while_casting>([&] { r("1.5").as_int64(); });
+		expect_exception<bad_variant_access>([&] { r("1").as_string(); });
+
+		// Numbers in arrays and maps are kept as text too
+		test(load_in_memory(r("[1,-2,3.5,{\"a\":4}]")) == array{ 1ull, -2ll, 3.5, map{ { "a", 4ull } } });
+
+		// Same syntax as json::read
+		expect_exception<json::ill_formatted_json_data>([&] { load_in_memory(r("[01]")); });
+		expect_exception<json::ill_formatted_json_data>([&] { r("-a"); });
+		expect_exception<json::ill_formatted_json_data>([&] { r("1.e5"); });
+		expect_exception<json::ill_formatted_json_data>([&] { r("1."); });
+		expect_exception<json::ill_formatted_json_data>([&] { r("1e+a"); });
+		expect_exception<stream::unexpected_end_of_stream>([&] { r("1e"); });
+		expect_exception<stream::unexpected_end_of_stream>([&] { r("-"); });
+	}
+
+	TEST_CASE(json_read_long_string)
+	{
+		// Put a character that needs special handling at every position within the first blocks scanned by the vectorized code path
+		auto r = [](const std::string& input)
+		{
+			return stream::read_all_as_string(json::read(stream::read_string_ref(input.c_str())).as_string());
+		};
+		for (size_t i = 0; i < 100; ++i)
+		{
+			auto prefix = std::string(i, 'a') + u8"\u00e9";
+			test(r("\"" + prefix + "\\n" + std::string(100, 'b') + "\"") == prefix.substr(0, i) + u8"\u00e9\n" + std::string(100, 'b'));
+			test(r("\"" + std::string(i, 'a') + "\"" + std::string(100, 'b')) == std::string(i, 'a'));
+			expect_exception<json::ill_formatted_json_data>([&] { r("\"" + std::string(i, 'a') + "\t" + std::string(100, 'b') + "\""); });
+			expect_exception<json::ill_formatted_json_data>([&] { r("\"" + std::string(i, 'a') + "\xF8" + std::string(100, 'b') + "\""); });
+			expect_exception<stream::unexpected_end_of_stream>([&] { r("\"" + std::string(i, 'a')); });
+		}
+	}
+
+	TEST_CASE(json_seek_to_end)
+	{
+		// seek_to_end skips strings, arrays and maps without parsing them: check where it stops, whatever the views of the stream look like
+		auto remaining = [](auto&& s, auto skip)
+		{
+			skip(json::read(stream::ref(s)));
+			return stream::read_all_as_string(s);
+		};
+		auto r = [&](const std::string& input, auto skip)
+		{
+			auto result = remaining(stream::read_string_ref(input.c_str()), skip);
+			test(remaining(reader_without_view{ stream::read_string_ref(input.c_str()) }, skip) == result);
+			test(remaining(stream::buffer<5>(reader_without_view{ stream::read_string_ref(input.c_str()) }), skip) == result);
+			return result;
+		};
+		auto whole = [](auto&& d) { seek_to_end(d); };
+
+		test(r("\"abc\" 1", whole) == " 1");
+		test(r("\"\" 1", whole) == " 1");
+		test(r("\"a\\\"]\\\\\" 1", whole) == " 1");
+		test(r("[] 1", whole) == " 1");
+		test(r("{} 1", whole) == " 1");
+		test(r("[1,[2,[]],{\"a\":{\"b\":[\"]}\"]}},\"[\\\"\\\\\",true] 1", whole) == " 1");
+		test(r("{\"a\\\\\":\"}\",\"b\":[{},[]]}] 1", whole) == "] 1");
+
+		// Delimiters and escapes at every position of the blocks scanned by the vectorized code path
+		for (size_t i = 0; i < 70; ++i)
+		{
+			auto a = std::string(i, 'a');
+			test(r("[\"" + a + "\\\"]" + std::string(40, 'b') + "\",{}] 1", whole) == " 1");
+			test(r("[\"" + a + "\\\\\"," + std::string(40, '[') + std::string(40, ']') + "] 1", whole) == " 1");
+			test(r("{\"" + a + "\":[" + a + "]} 1", whole) == " 1");
+			test(r("\"" + a + "\\\\\\\"\" 1", whole) == " 1");
+			expect_exception<stream::unexpected_end_of_stream>([&] { r("[\"" + a + "\\\"]", whole); });
+		}
+
+		// Partially read values
+		test(r("[1,[2,3],\"]\"] 1", [](auto&& d) { auto x = d.as_array(); test(x.read()->as_uint64() == 1); seek_to_end(x); }) == " 1");
+		test(r("{\"a\":[1],\"b\":2} 1", [](auto&& d) { auto x = d.as_map(); seek_to_end(*x.read_key()); seek_to_end(x); }) == " 1");
+		test(r("{\"a\":[1],\"b\":2} 1", [](auto&& d) { auto x = d.as_map(); seek_to_end(*x.read_key()); seek_to_end(x.read_value()); seek_to_end(x); }) == " 1");
+		test(r("\"\\u00e9\\\"a\" 1", [](auto&& d) { auto x = d.as_string(); byte c; test(x.read_partial_buffer({ &c, 1 }) == 1); seek_to_end(x); }) == " 1");
+		test(r("[[1],2] 1", [](auto&& d) { auto x = d.as_array(); seek_to_end(x); test(x.read() == nullopt); }) == " 1");
+	}
+
 	struct data_partially_parsed {};
 
 	template <class Exception>
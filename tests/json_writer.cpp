@@ -20,11 +20,33 @@ namespace goldfish { namespace dom
 		test(w(0ull) == "0");
 		test(w(1ull) == "1");
 		test(w(std::numeric_limits<uint64_t>::max()) == "18446744073709551615");
+		test(w(9ull) == "9");
+		test(w(10ull) == "10");
+		test(w(99ull) == "99");
+		test(w(100ull) == "100");
+		test(w(1000000007ull) == "1000000007");
 		test(w(0ll) == "0");
 		test(w(1ll) == "1");
 		test(w(-1ll) == "-1");
+		test(w(-10ll) == "-10");
+		test(w(-123456789ll) == "-123456789");
 		test(w(std::numeric_limits<int64_t>::max()) == "9223372036854775807");
 		test(w(std::numeric_limits<int64_t>::min()) == "-9223372036854775808");
+		test(w(0.0) == "0.0");
+		test(w(-0.0) == "-0.0");
+		test(w(1.0) == "1.0");
+		test(w(-1.5) == "-1.5");
+		test(w(0.1) == "0.1");
+		test(w(100.0) == "100.0");
+		test(w(0.0001) == "0.0001");
+		test(w(0.00001) == "1e-5");
+		test(w(1234567890123456.0) == "1234567890123456.0");
+		test(w(1e16) == "1e16");
+		test(w(1.2345678901234567e-100) == "1.2345678901234567e-100");
+		test(w(std::numeric_limits<double>::max()) == "1.7976931348623157e308");
+		test(w(std::numeric_limits<double>::denorm_min()) == "5e-324");
+		test(w(std::numeric_limits<double>::infinity()) == "null");
+		test(w(std::numeric_limits<double>::quiet_NaN()) == "null");
 		test(w("") == "\"\"");
 		test(w(u8"a\u0001\b\n\r\t\"\\/") == "\"a\\u0001\\b\\n\\r\\t\\\"\\\\/\"");
 		test(w(array{}) == "[]");
@@ -40,6 +62,29 @@ namespace goldfish { namespace dom
 		test(w(map{ { 1ull, 1ull } }) == "{\"1\":1}");
 	}
 
+	TEST_CASE(test_escape_long_strings)
+	{
+		// Characters to escape at every offset around the 16 and 32 bytes blocks scanned at once
+		auto w = [&](const std::string& s)
+		{
+			return json::create_writer(stream::string_writer{}).write(s);
+		};
+		for (size_t size = 0; size < 100; ++size)
+		{
+			test(w(std::string(size, 'a')) == "\"" + std::string(size, 'a') + "\"");
+			for (size_t i = 0; i < size; ++i)
+			{
+				for (char c : { '"', '\\', '\n', '\x1F', '\x7F', '\xE9' })
+				{
+					auto text = std::string(size, 'a');
+					text[i] = c;
+					auto escaped = c == '"' ? "\\\"" : c == '\\' ? "\\\\" : c == '\n' ? "\\n" : c == '\x1F' ? "\\u001F" : std::string(1, c);
+					test(w(text) == "\"" + std::string(i, 'a') + escaped + std::string(size - i - 1, 'a') + "\"");
+				}
+			}
+		}
+	}
+
 	TEST_CASE(test_roundtrip)
 	{
 		auto run = [](const char* data)
@@ -77,7 +122,34 @@ namespace goldfish { namespace dom
 		map.write(stream::read_string("Key"), 4);
 		map.write("Key", 5);
 
-		test(map.flush() == R"({"1":1,"-1":2,"0.500000":3,"S2V5":4,"Key":5})");
+		test(map.flush() == R"({"1":1,"-1":2,"0.5":3,"S2V5":4,"Key":5})");
+	}
+
+	TEST_CASE(constant_keys)
+	{
+		static constexpr auto a = make_key("a");
+		static constexpr auto escaped = make_key("\"\\\n\x01");
+
+		auto map = json::create_writer(stream::string_writer{}).start_map();
+		map.write(a, 1);
+		map.write(escaped, a);
+		map.write(make_key(""), 3);
+		auto inner = map.start_map(a);
+		inner.write(a, true);
+		inner.flush();
+		test(map.flush() == R"({"a":1,"\"\\\n\u0001":"a","":3,"a":{"a":true}})");
+	}
+
+	TEST_CASE(test_roundtrip_raw_numbers)
+	{
+		// Numbers kept as text are written back as is
+		auto run = [](const char* data)
+		{
+			test(json::create_writer(stream::string_writer{}).write(json::read_raw_numbers(stream::read_string_ref(data))) == data);
+		};
+		run("[0,-0,1.0,1.50,-1E+2,1e-400,1e400]");
+		run("[0.1000000000000000055511151231257827021181583404541015625]");
+		run("{\"a\":18446744073709551616,\"b\":[123456789012345678901234567890]}");
 	}
 
 	TEST_CASE(test_lossless_floating_point)
@@ -90,12 +162,15 @@ namespace goldfish { namespace dom
 			test(original_float == new_float);
 		};
 		run("0.0");
-		//run("-0.0");
+		run("-0.0");
 		run("1.2345");
 		run("-1.2345");
+		run("0.1");
 		run("5e-324");
-		//run("2.225073858507201e-308");
-		//run("2.2250738585072014e-308");
-		//run("1.7976931348623157e308");
+		run("2.225073858507201e-308");
+		run("2.2250738585072014e-308");
+		run("1.7976931348623157e308");
+		run("9007199254740993");
+		run("123456789.987654321");
 	}
 }}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include <goldfish/mmap_stream.h>
+#include <goldfish/file_stream.h>
+
+#include "unit_test.h"
+
+namespace goldfish { namespace stream
+{
+	static_assert(is_reader<mmap_reader>::value, "mmap_reader is a reader");
+
+	static void write_file(const char* path, const std::string& content)
+	{
+		file_writer writer(path);
+		writer.write_buffer({ reinterpret_cast<const byte*>(content.data()), content.size() });
+	}
+
+	TEST_CASE(test_mmap_reader)
+	{
+		write_file("mmap_reader_test.bin", "abcdefgh");
+		{
+			mmap_reader s("mmap_reader_test.bin");
+			test(s.file_data().size() == 8);
+			test(s.peek<char>() == 'a');
+			test(stream::read<char>(s) == 'a');
+			test(stream::read<std::array<char, 2>>(s) == std::array<char, 2>{ 'b', 'c' });
+			test(stream::seek(s, 2) == 2);
+
+			auto moved = std::move(s);
+			test(read_all_as_string(moved) == "fgh");
+			test(moved.peek<char>() == nullopt);
+			test(moved.file_data().size() == 8);
+		}
+		remove("mmap_reader_test.bin");
+	}
+	TEST_CASE(test_mmap_reader_seek_past_end)
+	{
+		write_file("mmap_reader_test_seek.bin", "abc");
+		{
+			mmap_reader s(std::string("mmap_reader_test_seek.bin"), mmap_access::random);
+			test(stream::seek(s, 10) == 3);
+			expect_exception<unexpected_end_of_stream>([&] { stream::read<char>(s); });
+		}
+		remove("mmap_reader_test_seek.bin");
+	}
+	TEST_CASE(test_mmap_reader_empty_file)
+	{
+		write_file("mmap_reader_test_empty.bin", "");
+		{
+			mmap_reader s("mmap_reader_test_empty.bin");
+			test(s.file_data().empty());
+			test(s.peek<char>() == nullopt);
+			test(read_all_as_string(s) == "");
+		}
+		remove("mmap_reader_test_empty.bin");
+	}
+	TEST_CASE(test_mmap_reader_file_not_found)
+	{
+		expect_exception<io_exception>([] { mmap_reader("this_file_does_not_exist.bin"); });
+	}
+}}
@@ -0,0 +1,82 @@
+#include <goldfish/prefetch_stream.h>
+#include <goldfish/buffered_stream.h>
+#include <goldfish/json_reader.h>
+
+#include "unit_test.h"
+
+namespace goldfish { namespace stream
+{
+	static_assert(is_reader<prefetch_reader<string_reader>>::value, "prefetch_reader is a reader");
+	static_assert(has_read_view<prefetch_reader<string_reader>>::value, "prefetch_reader exposes its chunks");
+
+	struct throwing_stream
+	{
+		size_t m_remaining;
+		size_t read_partial_buffer(buffer_ref buffer)
+		{
+			if (m_remaining == 0)
+				throw io_exception{ "Test read error" };
+			auto cb = std::min(buffer.size(), m_remaining);
+			std::fill(buffer.begin(), buffer.begin() + cb, 'a');
+			m_remaining -= cb;
+			return cb;
+		}
+	};
+
+	TEST_CASE(test_prefetch_reader)
+	{
+		auto t = [](size_t size, size_t chunk_size, size_t chunk_count)
+		{
+			std::string data;
+			for (size_t i = 0; i < size; ++i)
+				data.push_back(static_cast<char>('a' + i % 26));
+			test(read_all_as_string(prefetch(read_string(std::string(data)), chunk_size, chunk_count)) == data);
+		};
+		t(0, 1, 1);
+		t(1, 1, 1);
+		t(10, 3, 1);
+		t(10, 5, 2);
+		t(100000, 7, 3);
+		t(100000, 4096, 4);
+	}
+	TEST_CASE(test_prefetch_reader_read_view_and_seek)
+	{
+		auto s = prefetch(read_string("abcdefgh"), 3, 2);
+		auto view = s.read_view(10);
+		test(std::string(view.begin(), view.end()) == "abc");
+		s.consume(1);
+		test(stream::read<char>(s) == 'b');
+		test(stream::seek(s, 3) == 3);
+		test(stream::read<char>(s) == 'f');
+		test(stream::seek(s, 10) == 2);
+		test(s.read_view(10).empty());
+	}
+	TEST_CASE(test_prefetch_reader_json)
+	{
+		auto document = json::read(buffer<2>(prefetch(read_string("[1,2,\"three\"]"), 4, 2))).as_array();
+		test(document.read()->as_uint64() == 1);
+		test(document.read()->as_uint64() == 2);
+		test(read_all_as_string(document.read()->as_string()) == "three");
+		test(document.read() == nullopt);
+	}
+	TEST_CASE(test_prefetch_reader_error)
+	{
+		auto s = prefetch(throwing_stream{ 10 }, 4, 2);
+		expect_exception<io_exception>([&] { read_all(s); });
+	}
+	TEST_CASE(test_prefetch_reader_error_mid_chunk)
+	{
+		// The inner stream throws after filling half of the second chunk: the bytes before the error are still read
+		auto s = prefetch(throwing_stream{ 6 }, 4, 2);
+		std::string data(6, '\0');
+		test(read_full_buffer(s, { reinterpret_cast<byte*>(&data[0]), data.size() }) == 6);
+		test(data == "aaaaaa");
+		expect_exception<io_exception>([&] { stream::read<char>(s); });
+	}
+	TEST_CASE(test_prefetch_reader_destroyed_before_end)
+	{
+		// The worker thread is stopped even though it still has data to read
+		auto s = prefetch(read_string(std::string(100, 'a')), 1, 2);
+		test(stream::read<char>(s) == 'a');
+	}
+}}
@@ -1,6 +1,8 @@
 #include <goldfish/stream.h>
 #include <goldfish/reader_writer_stream.h>
+#include <string>
 #include <thread>
+#include <vector>
 #include "unit_test.h"
 
 namespace goldfish
@@ -128,10 +130,60 @@ namespace goldfish
 		{
 			expect_exception<stream::reader_writer_stream_closed>([&]
 			{
-				stream::write(writer, std::array<char, 5>{ 'h', 'e', 'l', 'l', 'o' });
+				// Write more than the capacity of the stream, so that the writer has to wait for the reader
+				std::vector<byte> data(stream::default_reader_writer_stream_capacity * 2, 'h');
+				writer.write_buffer(data);
 			});
 		});
 
+		reader.join();
+		writer.join();
+	}
+	TEST_CASE(test_reader_throws_after_writer_leave)
+	{
+		auto rws = stream::create_reader_writer_stream();
+
+		std::thread writer([writer = std::move(rws.writer)]() mutable
+		{
+			stream::write(writer, 'a');
+		});
+		std::thread reader([&]
+		{
+			test(stream::read<char>(rws.reader) == 'a');
+			expect_exception<stream::reader_writer_stream_closed>([&] { stream::read<char>(rws.reader); });
+		});
+
+		writer.join();
+		reader.join();
+	}
+	TEST_CASE(test_writer_doesnt_wait_for_reader)
+	{
+		auto rws = stream::create_reader_writer_stream(16);
+
+		// All the data fits in the stream, no need for a reader thread
+		stream::write(rws.writer, std::array<char, 16>{ 'a' });
+		rws.writer.flush();
+		test(stream::read_all_as_string(rws.reader) == std::string(1, 'a') + std::string(15, '\0'));
+	}
+	TEST_CASE(test_reader_writer_small_capacity)
+	{
+		auto rws = stream::create_reader_writer_stream(7 /*rounded up to 8*/);
+
+		std::string data;
+		for (int i = 0; i < 10000; ++i)
+			data += std::to_string(i);
+
+		std::thread reader([&]
+		{
+			test(stream::read_all_as_string(rws.reader) == data);
+		});
+		std::thread writer([&]
+		{
+			for (size_t i = 0; i < data.size(); i += 13)
+				rws.writer.write_buffer({ reinterpret_cast<const byte*>(data.data()) + i, std::min<size_t>(13, data.size() - i) });
+			rws.writer.flush();
+		});
+
 		reader.join();
 		writer.join();
 	}
@@ -0,0 +1,134 @@
+#include <goldfish/segmented_stream.h>
+#include <goldfish/cbor_reader.h>
+#include <goldfish/cbor_writer.h>
+#include "dom.h"
+#include "unit_test.h"
+
+namespace goldfish { namespace stream
+{
+	TEST_CASE(segmented_writer_empty)
+	{
+		auto result = segmented_writer{}.flush();
+		test(result.empty());
+		test(result.segment_count() == 0);
+		test(result.flatten().empty());
+		test(read_all(read_segmented_buffer(result)).empty());
+	}
+	TEST_CASE(segmented_writer_segments)
+	{
+		auto data = make_test_data<std::vector<byte>>(100);
+		segmented_writer writer(std::make_shared<segment_pool>(16));
+		writer.write_buffer({ data.data(), 50 });
+		for (size_t i = 50; i < 60; ++i)
+			stream::write(writer, data[i]);
+		writer.write_buffer({ data.data() + 60, 40 });
+		test(writer.size() == 100);
+
+		auto result = writer.flush();
+		test(result.size() == 100);
+		test(result.segment_count() == 7);
+		auto segments = result.segments();
+		test(segments.size() == 7);
+		for (size_t i = 0; i < 6; ++i)
+			test(segments[i].size() == 16 && std::equal(segments[i].begin(), segments[i].end(), data.begin() + i * 16));
+		test(segments[6].size() == 4 && std::equal(segments[6].begin(), segments[6].end(), data.begin() + 96));
+		test(result.flatten() == data);
+	}
+	TEST_CASE(segmented_writer_reserve)
+	{
+		// Tokens that don't fit at the end of a segment are split over two segments
+		auto data = make_test_data<std::vector<byte>>(100);
+		segmented_writer writer(std::make_shared<segment_pool>(16));
+		for (size_t i = 0; i < data.size(); i += 10)
+		{
+			auto output = writer.reserve(12);
+			std::copy(data.begin() + i, data.begin() + i + 10, output);
+			writer.commit(10);
+		}
+		auto result = writer.flush();
+		test(result.segment_count() == 7);
+		test(result.flatten() == data);
+	}
+	TEST_CASE(segmented_writer_large_writes)
+	{
+		auto data = make_test_data<std::vector<byte>>(1000000);
+		segmented_writer writer;
+		writer.write_buffer({ data.data(), 1 });
+		writer.write_buffer({ data.data() + 1, data.size() - 1 });
+		auto result = writer.flush();
+		test(result.segment_count() == (data.size() + default_segment_size - 1) / default_segment_size);
+		test(result.flatten() == data);
+		test(read_all(read_segmented_buffer(result)) == data);
+	}
+	TEST_CASE(segmented_writer_iovecs)
+	{
+		#ifndef _WIN32
+		auto data = make_test_data<std::vector<byte>>(100);
+		segmented_writer writer(std::make_shared<segment_pool>(32));
+		writer.write_buffer(data);
+		auto result = writer.flush();
+		auto iovecs = result.iovecs();
+		test(iovecs.size() == 4);
+		test(iovecs[0].iov_base == result.segment(0).data() && iovecs[0].iov_len == 32);
+		test(iovecs[3].iov_base == result.segment(3).data() && iovecs[3].iov_len == 4);
+		#endif
+	}
+	TEST_CASE(segmented_pool_reuses_segments)
+	{
+		auto pool = std::make_shared<segment_pool>(16);
+		const byte* first_segment;
+		{
+			segmented_writer writer(pool);
+			stream::write(writer, 'a');
+			auto result = writer.flush();
+			first_segment = result.segment(0).data();
+		}
+		segmented_writer writer(pool);
+		stream::write(writer, 'b');
+		auto result = writer.flush();
+		test(result.segment(0).data() == first_segment);
+	}
+	TEST_CASE(segmented_buffer_move_assignment_releases_segments)
+	{
+		auto pool = std::make_shared<segment_pool>(16);
+		segmented_writer first_writer(pool);
+		stream::write(first_writer, 'a');
+		auto result = first_writer.flush();
+		auto first_segment = result.segment(0).data();
+
+		segmented_writer second_writer(pool);
+		stream::write(second_writer, 'b');
+		result = second_writer.flush();
+		test(result.size() == 1 && result.segment(0)[0] == 'b');
+
+		segmented_writer third_writer(pool);
+		stream::write(third_writer, 'c');
+		test(third_writer.flush().segment(0).data() == first_segment);
+	}
+	TEST_CASE(segmented_buffer_reader)
+	{
+		auto data = make_test_data<std::vector<byte>>(100);
+		segmented_writer writer(std::make_shared<segment_pool>(16));
+		writer.write_buffer(data);
+		auto result = writer.flush();
+
+		auto reader = read_segmented_buffer(result);
+		byte buffer[10];
+		test(reader.read_partial_buffer(buffer) == 10 && std::equal(buffer, buffer + 10, data.begin()));
+		test(reader.read_partial_buffer(buffer) == 6 && std::equal(buffer, buffer + 6, data.begin() + 10));
+		test(reader.seek(20) == 20);
+		test(stream::read<byte>(reader) == data[36]);
+		test(reader.read_view(100).size() == 11);
+		test(reader.seek(1000) == 63);
+		test(reader.read_partial_buffer(buffer) == 0);
+	}
+	TEST_CASE(segmented_writer_cbor_document)
+	{
+		dom::document document = dom::array{ std::string(100000, 'a'), 1ull, dom::map{ { std::string("key"), std::string("value") } } };
+		segmented_writer writer(std::make_shared<segment_pool>(1024));
+		cbor::create_writer(stream::ref(writer)).write(document);
+		auto result = writer.flush();
+		test(result.segment_count() > 1);
+		test(dom::load_in_memory(cbor::read(read_segmented_buffer(result))) == document);
+	}
+}}
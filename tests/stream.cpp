@@ -7,6 +7,8 @@ static_assert(is_reader<const_buffer_ref_reader>::value, "const_buffer_ref_reade
 static_assert(!is_reader<vector_writer>::value, "vector_writer is not a reader");
 static_assert(!is_writer<const_buffer_ref_reader>::value, "const_buffer_ref_reader is not a writer");
 static_assert(is_writer<vector_writer>::value, "vector_writer is a writer");
+static_assert(has_read_view<const_buffer_ref_reader>::value, "const_buffer_ref_reader exposes its data");
+static_assert(has_read_view<ref_reader<string_reader>>::value, "ref_reader forwards read_view");
 
 TEST_CASE(test_skip)
 {
@@ -92,4 +94,65 @@ TEST_CASE(test_copy)
 	test_string_of_size(typical_buffer_length * 2 + 1);
 }
 
+TEST_CASE(test_read_view)
+{
+	auto s = read_string("Hello");
+	auto view = s.read_view(3);
+	test(std::string(view.begin(), view.end()) == "Hel");
+	s.consume(1);
+	view = s.read_view(10);
+	test(std::string(view.begin(), view.end()) == "ello");
+	s.consume(4);
+	test(s.read_view(10).empty());
+}
+
+TEST_CASE(test_reserve)
+{
+	struct reserving_writer
+	{
+		byte* reserve(size_t cb) { data.resize(size + cb); return reinterpret_cast<byte*>(&data[size]); }
+		void commit(size_t cb) { size += cb; data.resize(size); }
+		void write_buffer(const_buffer_ref d) { data.append(reinterpret_cast<const char*>(d.begin()), d.size()); size += d.size(); }
+		std::string data;
+		size_t size = 0;
+	};
+	static_assert(has_reserve<ref_writer<reserving_writer>>::value, "ref_writer forwards reserve");
+	static_assert(!has_reserve<string_writer>::value && !has_reserve<vector_writer>::value, "Those writers can't reserve without value-initializing");
+
+	auto write_tokens = [](auto&& w)
+	{
+		write_token<8>(w, [](byte* output) { memcpy(output, "Hello", 5); return output + 5; });
+		write_token<8>(w, [](byte* output) { *output = ' '; return output + 1; });
+		write_token<8>(w, [](byte* output) { return output; });
+		write_token<8>(w, [](byte* output) { memcpy(output, "world", 5); return output + 5; });
+	};
+
+	reserving_writer r;
+	write_tokens(ref(r));
+	test(r.data == "Hello world");
+
+	string_writer s;
+	write_tokens(s);
+	test(s.flush() == "Hello world");
+
+	vector_writer v;
+	write_tokens(ref(v));
+	test(v.flush() == std::vector<byte>{ 'H', 'e', 'l', 'l', 'o', ' ', 'w', 'o', 'r', 'l', 'd' });
+}
+
+TEST_CASE(test_copy_without_read_view)
+{
+	struct reader_without_view
+	{
+		const_buffer_ref_reader m_inner;
+		size_t read_partial_buffer(buffer_ref buffer) { return m_inner.read_partial_buffer(buffer); }
+	};
+	static_assert(!has_read_view<reader_without_view>::value, "reader_without_view doesn't expose its data");
+
+	std::string data(typical_buffer_length * 2 + 1, 'a');
+	string_writer w;
+	copy(reader_without_view{ read_string_ref(data) }, w);
+	test(w.flush() == data);
+}
+
 }}
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 #include "CppUnitTest.h"
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -26,4 +28,13 @@ template <class Exception, class Lambda> void expect_exception(Lambda&& l)
 	catch (const Exception&)
 	{
 	}
+}
+
+// Every byte value, repeating every 1021 bytes so that the data also compresses
+template <class Container = std::string> Container make_test_data(size_t size)
+{
+	Container data(size, 0);
+	for (size_t i = 0; i < size; ++i)
+		data[i] = static_cast<typename Container::value_type>(i % 1021 * 7 + i % 1021 / 256);
+	return data;
 }
\ No newline at end of file
@@ -0,0 +1,101 @@
+// Not part of tests.vcxproj since it requires libzstd, see README.md to build it
+#include <goldfish/zstd_stream.h>
+#include <goldfish/buffered_stream.h>
+#include <goldfish/json_reader.h>
+#include "unit_test.h"
+
+namespace goldfish { namespace stream
+{
+	static std::vector<byte> zstd_compress(const std::string& data, int compression_level = ZSTD_CLEVEL_DEFAULT)
+	{
+		auto s = compress_zstd_to(vector_writer{}, compression_level);
+		s.write_buffer({ reinterpret_cast<const byte*>(data.data()), data.size() });
+		return s.flush();
+	}
+
+	TEST_CASE(zstd_round_trip)
+	{
+		for (size_t size : { 0, 1, 100, 100000, 1000000 })
+		{
+			auto data = make_test_data(size);
+			auto compressed = zstd_compress(data);
+			test(read_all_as_string(decompress_zstd(read_buffer_ref(compressed))) == data);
+		}
+	}
+	TEST_CASE(zstd_compression_level)
+	{
+		auto data = make_test_data(100000);
+		auto fast = zstd_compress(data, 1);
+		auto best = zstd_compress(data, 19);
+		test(best.size() < fast.size());
+		test(fast.size() < data.size());
+		test(read_all_as_string(decompress_zstd(read_buffer_ref(fast))) == data);
+		test(read_all_as_string(decompress_zstd(read_buffer_ref(best))) == data);
+	}
+	TEST_CASE(zstd_multi_threaded_compression)
+	{
+		auto data = make_test_data(10000000);
+		auto s = compress_zstd_to(vector_writer{}, ZSTD_CLEVEL_DEFAULT, 4 /*worker_count*/);
+		for (size_t i = 0; i < data.size(); i += 100000)
+			s.write_buffer({ reinterpret_cast<const byte*>(data.data()) + i, std::min<size_t>(100000, data.size() - i) });
+		auto compressed = s.flush();
+		test(compressed.size() < data.size());
+		test(read_all_as_string(decompress_zstd(read_buffer_ref(compressed))) == data);
+	}
+	static std::string read_in_small_pieces(const std::vector<byte>& compressed)
+	{
+		auto s = decompress_zstd(read_buffer_ref(compressed));
+		std::string result;
+		byte buffer[7];
+		while (auto cb = s.read_partial_buffer(buffer))
+			result.append(reinterpret_cast<const char*>(buffer), cb);
+		return result;
+	}
+	TEST_CASE(zstd_read_small_pieces)
+	{
+		auto data = make_test_data(10000);
+		test(read_in_small_pieces(zstd_compress(data)) == data);
+	}
+	TEST_CASE(zstd_read_small_pieces_without_checksum)
+	{
+		// Without a checksum, the frame ends with its last block: zstd still has some of its data once all the input is consumed
+		auto data = make_test_data(10000);
+		std::vector<byte> compressed(ZSTD_compressBound(data.size()));
+		compressed.resize(details::check_zstd_result(ZSTD_compress(compressed.data(), compressed.size(), data.data(), data.size(), ZSTD_CLEVEL_DEFAULT)));
+		test(read_in_small_pieces(compressed) == data);
+	}
+	TEST_CASE(zstd_concatenated_members)
+	{
+		auto compressed = zstd_compress("Hello ");
+		auto second = zstd_compress("world");
+		compressed.insert(compressed.end(), second.begin(), second.end());
+		test(read_all_as_string(decompress_zstd(read_buffer_ref(compressed))) == "Hello world");
+	}
+	TEST_CASE(zstd_invalid_data)
+	{
+		expect_exception<ill_formatted_zstd_data>([] { read_all(decompress_zstd(read_string("not compressed data"))); });
+
+		auto compressed = zstd_compress(make_test_data(1000));
+		compressed[compressed.size() / 2] ^= 0xFF;
+		expect_exception<ill_formatted_zstd_data>([&] { read_all(decompress_zstd(read_buffer_ref(compressed))); });
+	}
+	TEST_CASE(zstd_truncated_data)
+	{
+		auto compressed = zstd_compress(make_test_data(1000));
+		compressed.resize(compressed.size() - 1);
+		expect_exception<ill_formatted_zstd_data>([&] { read_all(decompress_zstd(read_buffer_ref(compressed))); });
+	}
+	TEST_CASE(zstd_json_document)
+	{
+		std::string json = "[0";
+		for (uint64_t i = 1; i < 1000; ++i)
+			json += "," + std::to_string(i);
+		json += "]";
+		auto compressed = zstd_compress(json);
+
+		auto document = json::read(buffer<8192>(decompress_zstd(read_buffer_ref(compressed)))).as_array();
+		for (uint64_t i = 0; i < 1000; ++i)
+			test(document.read()->as_uint64() == i);
+		test(document.read() == nullopt);
+	}
+}}